@@ -10,5 +10,14 @@ public class SurvivalGameTarget : TargetRules
 		Type = TargetType.Game;
 
 		ExtraModuleNames.AddRange( new string[] { "SurvivalGame" } );
+
+		// Items, inventories and pickups mark their replicated properties dirty themselves, see MARK_PROPERTY_DIRTY_FROM_NAME.
+		// Compiling push model in needs a unique build environment, which installed (launcher) engines can't build, so it's only
+		// turned on when building against an engine built from source. The editor target stays on the shared environment.
+		if (!UnrealBuildTool.IsEngineInstalled())
+		{
+			BuildEnvironment = TargetBuildEnvironment.Unique;
+			bWithPushModel = true;
+		}
 	}
 }
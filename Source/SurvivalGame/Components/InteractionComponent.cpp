@@ -4,25 +4,106 @@
 #include "Components/InteractionComponent.h"
 #include "Player/SurvivalCharacter.h"
 #include "Widgets/InteractionWidget.h"
+#include "World/InteractionSubsystem.h"
+#include "World/HighlightSubsystem.h"
+#include "Widgets/InteractionPromptSubsystem.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
 
 UInteractionComponent::UInteractionComponent() :
-	InteractionTime(0.f), InteractionDistance(200.f), InteractableNameText(FText::FromString("Interactable Object")),
-	InteractableActionText(FText::FromString("Interact")), bAllowMultipleInteractors(true)
+	LastFocusTime(0.f), InteractionTime(0.f), InteractionDistance(200.f), InteractProgressUpdateRate(0.f), InteractableNameText(FText::FromString("Interactable Object")),
+	InteractableActionText(FText::FromString("Interact")), bAllowMultipleInteractors(true), bUseSharedPrompt(true), WidgetClass(nullptr), Space(EWidgetSpace::Screen), DrawSize(600, 100),
+	bDrawAtDesiredSize(true), WidgetComponent(nullptr)
 {
-	SetComponentTickEnabled(false);
-
-	Space = EWidgetSpace::Screen;
-	DrawSize = FIntPoint(600, 100);
-	bDrawAtDesiredSize = true;
+	PrimaryComponentTick.bCanEverTick = false;
 
 	SetActive(true);
-	SetHiddenInGame(true);
+}
+
+void UInteractionComponent::BeginPlay()
+{
+	Super::BeginPlay();
+
+	TransformUpdated.AddUObject(this, &UInteractionComponent::OnInteractableMoved);
+
+	if (IsActive())
+	{
+		RegisterWithSubsystem();
+	}
+
+	// Only clients draw the focus outline
+	if (!GetOwner()->HasAuthority())
+	{
+		if (UHighlightSubsystem* HighlightSubsystem = GetWorld()->GetSubsystem<UHighlightSubsystem>())
+		{
+			HighlightSubsystem->RegisterInteractable(this);
+		}
+	}
+}
+
+void UInteractionComponent::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	UnregisterFromSubsystem();
+	TransformUpdated.RemoveAll(this);
+	OnInteractableChanged.Broadcast(this);
+
+	if (UHighlightSubsystem* HighlightSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UHighlightSubsystem>() : nullptr)
+	{
+		HighlightSubsystem->UnregisterInteractable(this);
+	}
+
+	if (WidgetComponent)
+	{
+		WidgetComponent->DestroyComponent();
+		WidgetComponent = nullptr;
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void UInteractionComponent::Activate(bool bReset)
+{
+	Super::Activate(bReset);
+
+	if (IsActive() && HasBegunPlay())
+	{
+		RegisterWithSubsystem();
+	}
+}
+
+void UInteractionComponent::RegisterWithSubsystem()
+{
+	if (UInteractionSubsystem* InteractionSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr)
+	{
+		InteractionSubsystem->RegisterInteractable(this);
+	}
+}
+
+void UInteractionComponent::UnregisterFromSubsystem()
+{
+	if (UInteractionSubsystem* InteractionSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr)
+	{
+		InteractionSubsystem->UnregisterInteractable(this);
+	}
+}
+
+void UInteractionComponent::OnInteractableMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport)
+{
+	if (UInteractionSubsystem* InteractionSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UInteractionSubsystem>() : nullptr)
+	{
+		InteractionSubsystem->UpdateInteractable(this);
+	}
+
+	OnInteractableChanged.Broadcast(this);
 }
 
 void UInteractionComponent::Deactivate()
 {
 	Super::Deactivate();
 
+	UnregisterFromSubsystem();
+	OnInteractableChanged.Broadcast(this);
+
 	for (int32 i = Interactors.Num() - 1; i >= 0; --i)
 	{
 		if (ASurvivalCharacter* Interactor = Interactors[i])
@@ -32,6 +113,7 @@ void UInteractionComponent::Deactivate()
 		}
 	}
 	Interactors.Empty();
+	Focusers.Empty();
 }
 
 bool UInteractionComponent::CanInteract(ASurvivalCharacter* character) const
@@ -41,11 +123,55 @@ bool UInteractionComponent::CanInteract(ASurvivalCharacter* character) const
 	return !bPlayerAlreadyInteracting && IsActive() && GetOwner() != nullptr && character != nullptr;
 }
 
+UWidgetComponent* UInteractionComponent::GetOrCreateWidgetComponent()
+{
+	if (WidgetComponent || !WidgetClass || GetNetMode() == NM_DedicatedServer || !GetOwner())
+	{
+		return WidgetComponent;
+	}
+
+	WidgetComponent = NewObject<UWidgetComponent>(GetOwner(), NAME_None, RF_Transient);
+	WidgetComponent->SetWidgetSpace(Space);
+	WidgetComponent->SetDrawSize(FVector2D(DrawSize));
+	WidgetComponent->SetDrawAtDesiredSize(bDrawAtDesiredSize);
+	WidgetComponent->SetWidgetClass(WidgetClass);
+	WidgetComponent->SetHiddenInGame(true);
+	WidgetComponent->SetupAttachment(this);
+	WidgetComponent->RegisterComponent();
+
+	return WidgetComponent;
+}
+
+UInteractionPromptSubsystem* UInteractionComponent::GetPromptSubsystem(ASurvivalCharacter* character) const
+{
+	APlayerController* PlayerController = character ? Cast<APlayerController>(character->GetController()) : nullptr;
+	ULocalPlayer* LocalPlayer = PlayerController ? PlayerController->GetLocalPlayer() : nullptr;
+
+	return LocalPlayer ? LocalPlayer->GetSubsystem<UInteractionPromptSubsystem>() : nullptr;
+}
+
 void UInteractionComponent::RefreshWidget()
 {
-	if (!bHiddenInGame && GetOwner()->GetNetMode() != NM_DedicatedServer)
+	if (bUseSharedPrompt)
 	{
-		if (UInteractionWidget* InteractionWidget = Cast<UInteractionWidget>(GetUserWidgetObject()))
+		// Only the local players' prompts can be showing us
+		if (GetNetMode() != NM_DedicatedServer)
+		{
+			for (FConstPlayerControllerIterator It = GetWorld()->GetPlayerControllerIterator(); It; ++It)
+			{
+				ULocalPlayer* LocalPlayer = It->IsValid() ? (*It)->GetLocalPlayer() : nullptr;
+				if (UInteractionPromptSubsystem* PromptSubsystem = LocalPlayer ? LocalPlayer->GetSubsystem<UInteractionPromptSubsystem>() : nullptr)
+				{
+					PromptSubsystem->RefreshPrompt(this);
+				}
+			}
+		}
+		return;
+	}
+
+	if (WidgetComponent && !WidgetComponent->bHiddenInGame)
+	{
+		if (UInteractionWidget* InteractionWidget = Cast<UInteractionWidget>(WidgetComponent->GetUserWidgetObject()))
 		{
 			InteractionWidget->UpdateInteractionWidget(this);
 		}
@@ -59,36 +185,68 @@ void UInteractionComponent::BeginFocus(ASurvivalCharacter* character)
 
 	OnBeginFocus.Broadcast(character);
 
-	SetHiddenInGame(false);
+	SetHighlighted(true);
 
-	if (!GetOwner()->HasAuthority())
+	if (bUseSharedPrompt)
 	{
-		for (auto& visualComp : GetOwner()->GetComponentsByClass(UPrimitiveComponent::StaticClass()))
+		if (UInteractionPromptSubsystem* PromptSubsystem = GetPromptSubsystem(character))
 		{
-			if (UPrimitiveComponent* primitive = Cast<UPrimitiveComponent>(visualComp))
-			{
-				primitive->SetRenderCustomDepth(true);
-			}
+			PromptSubsystem->ShowPrompt(this);
 		}
+		return;
+	}
+
+	if (UWidgetComponent* Widget = GetOrCreateWidgetComponent())
+	{
+		Widget->SetHiddenInGame(false);
+		RefreshWidget();
 	}
-	RefreshWidget();
 }
 
 void UInteractionComponent::EndFocus(ASurvivalCharacter* character)
 {
 	OnEndFocus.Broadcast(character);
 
-	SetHiddenInGame(true);
+	SetHighlighted(false);
 
-	if (!GetOwner()->HasAuthority())
+	if (bUseSharedPrompt)
 	{
-		for (auto& visualComp : GetOwner()->GetComponentsByClass(UPrimitiveComponent::StaticClass()))
+		if (UInteractionPromptSubsystem* PromptSubsystem = GetPromptSubsystem(character))
 		{
-			if (UPrimitiveComponent* primitive = Cast<UPrimitiveComponent>(visualComp))
-			{
-				primitive->SetRenderCustomDepth(false);
-			}
+			PromptSubsystem->HidePrompt(this);
 		}
+		return;
+	}
+
+	if (WidgetComponent)
+	{
+		WidgetComponent->SetHiddenInGame(true);
+	}
+}
+
+void UInteractionComponent::AddFocuser(ASurvivalCharacter* character)
+{
+	if (character)
+	{
+		Focusers.AddUnique(character);
+		LastFocusTime = GetWorld()->GetTimeSeconds();
+	}
+}
+
+void UInteractionComponent::RemoveFocuser(ASurvivalCharacter* character)
+{
+	if (Focusers.RemoveSingle(character) > 0)
+	{
+		LastFocusTime = GetWorld()->GetTimeSeconds();
+	}
+}
+
+void UInteractionComponent::SetHighlighted(const bool bHighlighted)
+{
+	// Outlines are batched up and applied once per frame. Only clients register, so this does nothing on the server.
+	if (UHighlightSubsystem* HighlightSubsystem = GetWorld() ? GetWorld()->GetSubsystem<UHighlightSubsystem>() : nullptr)
+	{
+		HighlightSubsystem->SetHighlighted(this, bHighlighted);
 	}
 }
 
@@ -98,6 +256,11 @@ void UInteractionComponent::BeginInteract(ASurvivalCharacter* character)
 	{
 		Interactors.AddUnique(character);
 		OnBeginInteract.Broadcast(character);
+
+		if (!FMath::IsNearlyZero(InteractionTime))
+		{
+			BeginInteractProgress(character);
+		}
 	}
 }
 
@@ -105,12 +268,64 @@ void UInteractionComponent::EndInteract(ASurvivalCharacter* character)
 {
 	Interactors.RemoveSingle(character);
 	OnEndInteract.Broadcast(character);
+
+	if (InteractorsInProgress.Contains(character))
+	{
+		EndInteractProgress(character, false);
+	}
 }
 
 void UInteractionComponent::Interact(ASurvivalCharacter* character)
 {
 	if (CanInteract(character))
+	{
+		if (InteractorsInProgress.Contains(character))
+		{
+			EndInteractProgress(character, true);
+		}
+
 		OnInteract.Broadcast(character);
+	}
+}
+
+void UInteractionComponent::BeginInteractProgress(ASurvivalCharacter* character)
+{
+	const FInteractionProgress Progress(GetWorld()->GetTimeSeconds(), InteractionTime, InteractProgressUpdateRate);
+
+	InteractorsInProgress.AddUnique(character);
+	OnInteractProgressBegin.Broadcast(character, Progress);
+
+	if (UInteractionWidget* InteractionWidget = GetInteractionWidget(character))
+	{
+		InteractionWidget->BeginInteractProgress(Progress);
+	}
+}
+
+void UInteractionComponent::EndInteractProgress(ASurvivalCharacter* character, const bool bCompleted)
+{
+	InteractorsInProgress.RemoveSingle(character);
+	OnInteractProgressEnd.Broadcast(character, bCompleted);
+
+	if (UInteractionWidget* InteractionWidget = GetInteractionWidget(character))
+	{
+		InteractionWidget->EndInteractProgress(bCompleted);
+	}
+}
+
+UInteractionWidget* UInteractionComponent::GetInteractionWidget(ASurvivalCharacter* character) const
+{
+	if (!character || !character->IsLocallyControlled())
+	{
+		return nullptr;
+	}
+
+	if (bUseSharedPrompt)
+	{
+		UInteractionPromptSubsystem* PromptSubsystem = GetPromptSubsystem(character);
+		return PromptSubsystem ? PromptSubsystem->GetPromptFor(this) : nullptr;
+	}
+
+	return WidgetComponent ? Cast<UInteractionWidget>(WidgetComponent->GetUserWidgetObject()) : nullptr;
 }
 
 float UInteractionComponent::GetInteractPercentage()
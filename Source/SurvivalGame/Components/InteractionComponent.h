@@ -3,10 +3,12 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Components/SceneComponent.h"
 #include "Components/WidgetComponent.h"
 #include "InteractionComponent.generated.h"
 
 class ASurvivalCharacter;
+class UInteractionWidget;
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnBeginInteract, ASurvivalCharacter*, Character);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEndInteract, ASurvivalCharacter*, Character);
@@ -14,11 +16,47 @@ DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnBeginFocus, ASurvivalCharacter*,
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnEndFocus, ASurvivalCharacter*, Character);
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInteract, ASurvivalCharacter*, Character);
 
+/** Everything UI needs to animate a timed interact by itself, so it doesn't have to poll GetInteractPercentage() every frame. */
+USTRUCT(BlueprintType)
+struct FInteractionProgress
+{
+	GENERATED_BODY()
+
+public:
+	FInteractionProgress() : StartTime(0.f), Duration(0.f), UpdateRate(0.f) {};
+	FInteractionProgress(const float InStartTime, const float InDuration, const float InUpdateRate) : StartTime(InStartTime), Duration(InDuration), UpdateRate(InUpdateRate) {};
+
+	// 0-1 progress at the given world time.
+	FORCEINLINE float GetAlpha(const float TimeSeconds) const
+	{
+		return Duration > 0.f ? FMath::Clamp((TimeSeconds - StartTime) / Duration, 0.f, 1.f) : 1.f;
+	}
+
+	// World time the interact started at.
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float StartTime;
+
+	// How long the interact takes in seconds.
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float Duration;
+
+	// How often in seconds the UI needs to update its progress display. 0 means every frame.
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction")
+	float UpdateRate;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnInteractProgressBegin, ASurvivalCharacter*, Character, const FInteractionProgress&, Progress);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnInteractProgressEnd, ASurvivalCharacter*, Character, bool, bCompleted);
+
+// Native only, fired often enough (every move) that it shouldn't go through Blueprint.
+DECLARE_MULTICAST_DELEGATE_OneParam(FOnInteractableChanged, class UInteractionComponent*);
+
 /**
- * 
+ * Holds only the interaction data for its owner. The prompt is drawn by the local player's UInteractionPromptSubsystem,
+ * or by a widget component we create on first focus when not using the shared prompt, so servers never make any widgets.
  */
 UCLASS(ClassGroup = (Custom), meta = (BlueprintSpawnableComponent))
-class SURVIVALGAME_API UInteractionComponent : public UWidgetComponent
+class SURVIVALGAME_API UInteractionComponent : public USceneComponent
 {
 	GENERATED_BODY()
 	
@@ -46,16 +84,64 @@ public:
 	//[local + server] Called when the player has interacted with the item for the required amount of time
 	UPROPERTY(EditDefaultsOnly, BlueprintAssignable)
 	FOnInteract OnInteract;
+
+	//[local + server] Called when a timed interact starts, with what's needed to animate its progress.
+	UPROPERTY(EditDefaultsOnly, BlueprintAssignable)
+	FOnInteractProgressBegin OnInteractProgressBegin;
+
+	//[local + server] Called when a timed interact completes, or gets cancelled partway through.
+	UPROPERTY(EditDefaultsOnly, BlueprintAssignable)
+	FOnInteractProgressEnd OnInteractProgressEnd;
+
+	// Called when we move, get deactivated or are about to go away, so characters focusing us know to look again.
+	FOnInteractableChanged OnInteractableChanged;
 	
 protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void Activate(bool bReset = false) override;
 	virtual void Deactivate() override;
 
+	// Our own prompt when not using the shared one. Only created on clients, the first time we're focused.
+	UWidgetComponent* GetOrCreateWidgetComponent();
+
+	// The local player's shared prompt, if this character is locally controlled.
+	class UInteractionPromptSubsystem* GetPromptSubsystem(ASurvivalCharacter* character) const;
+
+	// Active interactables are kept in the world's UInteractionSubsystem, so characters can find them without tracing.
+	void RegisterWithSubsystem();
+	void UnregisterFromSubsystem();
+
+	// Keeps our cell in the interaction subsystem up to date as the owner moves around.
+	void OnInteractableMoved(USceneComponent* UpdatedComponent, EUpdateTransformFlags UpdateTransformFlags, ETeleportType Teleport);
+
+	// Show or hide the focus outline on the owner's meshes, through the world's UHighlightSubsystem.
+	void SetHighlighted(const bool bHighlighted);
+
 	bool CanInteract(ASurvivalCharacter* character) const;
 
 	// On the server, this will hold all interactors. On the local player, this will just hold the local player (provided they are an interactor).
 	UPROPERTY()
 	TArray<ASurvivalCharacter*> Interactors;
 
+	// Interactors partway through a timed interact, so we know whether ending the interact cancels progress.
+	UPROPERTY()
+	TArray<ASurvivalCharacter*> InteractorsInProgress;
+
+	// [server] Players whose clients say they're focusing us. The server doesn't run focus checks itself, so this is how it knows.
+	UPROPERTY()
+	TArray<ASurvivalCharacter*> Focusers;
+
+	// [server] World time someone last started or stopped focusing us.
+	float LastFocusTime;
+
+	// Tell the widget showing us to this character about progress. Only does anything for locally controlled characters.
+	void BeginInteractProgress(ASurvivalCharacter* character);
+	void EndInteractProgress(ASurvivalCharacter* character, const bool bCompleted);
+
+	// The widget this character sees for us, if any.
+	UInteractionWidget* GetInteractionWidget(ASurvivalCharacter* character) const;
+
 public:
 	/** Refresh the interaction widget and its custom widgets.
 	  * An example of when we'd use this is when we take 3 items out of a stack of 10, and we need the update the widget
@@ -66,6 +152,12 @@ public:
 	void BeginFocus(ASurvivalCharacter* character);
 	void EndFocus(ASurvivalCharacter* character);
 
+	// [server] Called as players report what they're focusing, see ASurvivalCharacter::ServerSetFocusedInteractable().
+	void AddFocuser(ASurvivalCharacter* character);
+	void RemoveFocuser(ASurvivalCharacter* character);
+
+	FORCEINLINE float GetLastFocusTime() const { return LastFocusTime; }
+
 	void BeginInteract(ASurvivalCharacter* character);
 	void EndInteract(ASurvivalCharacter* character);
 
@@ -73,12 +165,17 @@ public:
 
 	// Return a value from 0-1 denoting how far through the interact we are.
 	// On server this is the first interactors percentage, on client this is the local interactors percentage.
+	// Asks the interactor every call, so UI should use OnInteractProgressBegin/End and UInteractionWidget::GetInteractProgressAlpha() rather than binding to this.
 	UFUNCTION(BlueprintPure, Category = "Interaction")
 	float GetInteractPercentage();
 
+	FORCEINLINE TSubclassOf<UInteractionWidget> GetWidgetClass() const { return WidgetClass; }
 	FORCEINLINE float GetInteractionDistance() const { return InteractionDistance; }
 	FORCEINLINE float GetInteractionTime() const { return InteractionTime; }
 
+	// Whether anyone is focusing or interacting with us. The server knows about every player, clients only about the local player's interacts.
+	FORCEINLINE bool HasInteractors() const { return Interactors.Num() > 0 || Focusers.Num() > 0; }
+
 	FORCEINLINE void SetInteractionTime(float interactionTime) { InteractionTime = interactionTime; }
 	FORCEINLINE void SetInteractionDistance(float interactionDistance) { InteractionDistance = interactionDistance; }
 	
@@ -95,6 +192,10 @@ private:
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (AllowPrivateAccess = "true"))
 	float InteractionDistance;
 
+	// How often in seconds progress UI needs to update during a timed interact. 0 means every frame.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (ClampMin = 0.0, AllowPrivateAccess = "true"))
+	float InteractProgressUpdateRate;
+
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (AllowPrivateAccess = "true"))
 	FText InteractableNameText;
 
@@ -103,4 +204,27 @@ private:
 
 	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (AllowPrivateAccess = "true"))
 	bool bAllowMultipleInteractors;
+
+	/** Don't create our own widget. The local player's UInteractionPromptSubsystem shows a single prompt (made from our widget class)
+	 * over whatever they're focusing instead, which saves a user widget per interactable in the world. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (AllowPrivateAccess = "true"))
+	bool bUseSharedPrompt;
+
+	/** The prompt to show when we're focused. This and the settings below have the same names as UWidgetComponent's,
+	 * which we used to be, so interactables saved back then still load their overrides. */
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (AllowPrivateAccess = "true"))
+	TSubclassOf<UInteractionWidget> WidgetClass;
+
+	// The rest only apply to our own prompt, when not using the shared one.
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (EditCondition = "!bUseSharedPrompt", AllowPrivateAccess = "true"))
+	EWidgetSpace Space;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (EditCondition = "!bUseSharedPrompt", AllowPrivateAccess = "true"))
+	FIntPoint DrawSize;
+
+	UPROPERTY(EditAnywhere, BlueprintReadOnly, Category = "Interaction", meta = (EditCondition = "!bUseSharedPrompt", AllowPrivateAccess = "true"))
+	bool bDrawAtDesiredSize;
+
+	UPROPERTY(Transient)
+	UWidgetComponent* WidgetComponent;
 };
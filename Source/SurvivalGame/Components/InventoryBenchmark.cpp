@@ -0,0 +1,135 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/InventoryBenchmark.h"
+#include "Components/InventoryComponent.h"
+#include "HAL/PlatformTime.h"
+
+namespace
+{
+	double ElapsedMs(const double StartTime)
+	{
+		return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	}
+}
+
+UInventoryBenchmarkItem::UInventoryBenchmarkItem()
+{
+	bStackable = false;
+	Weight = 1.f;
+}
+
+FInventoryBenchmark::FInventoryBenchmark(const TArray<TSubclassOf<UItem>>& ItemClasses)
+{
+	for (const TSubclassOf<UItem>& ItemClass : ItemClasses)
+	{
+		if (ItemClass)
+		{
+			(GetDefault<UItem>(ItemClass)->GetIsStackable() ? StackableClasses : SingleClasses).Add(ItemClass);
+		}
+	}
+
+	if (SingleClasses.Num() == 0)
+	{
+		SingleClasses.Add(UInventoryBenchmarkItem::StaticClass());
+	}
+}
+
+FInventoryBenchmarkResult FInventoryBenchmark::Run(UInventoryComponent* Inventory, const int32 NumItems) const
+{
+	FInventoryBenchmarkResult Result;
+	Result.NumItems = NumItems;
+
+	double StartTime = FPlatformTime::Seconds();
+	Add(Inventory, NumItems);
+	Result.AddMs = ElapsedMs(StartTime);
+	Result.NumSlots = Inventory->GetNumUsedSlots();
+
+	StartTime = FPlatformTime::Seconds();
+	Find(Inventory, NumItems);
+	Result.FindMs = ElapsedMs(StartTime);
+
+	StartTime = FPlatformTime::Seconds();
+	Weight(Inventory, NumItems);
+	Result.WeightMs = ElapsedMs(StartTime);
+
+	StartTime = FPlatformTime::Seconds();
+	Consume(Inventory, NumItems);
+	Result.ConsumeMs = ElapsedMs(StartTime);
+
+	StartTime = FPlatformTime::Seconds();
+	Remove(Inventory);
+	Result.RemoveMs = ElapsedMs(StartTime);
+
+	return Result;
+}
+
+void FInventoryBenchmark::Add(UInventoryComponent* Inventory, const int32 NumItems) const
+{
+	const int32 NumStacks = FMath::Min(StackableClasses.Num(), NumItems);
+
+	for (int32 i = 0; i < NumStacks; ++i)
+	{
+		Inventory->TryAddItemFromClass(StackableClasses[i], GetDefault<UItem>(StackableClasses[i])->GetMaxStackSize());
+	}
+
+	for (int32 i = NumStacks; i < NumItems; ++i)
+	{
+		Inventory->TryAddItemFromClass(SingleClasses[i % SingleClasses.Num()], 1);
+	}
+}
+
+void FInventoryBenchmark::Find(UInventoryComponent* Inventory, const int32 NumItems) const
+{
+	for (int32 i = 0; i < NumItems; ++i)
+	{
+		Inventory->FindItemByClass(SingleClasses[i % SingleClasses.Num()]);
+	}
+}
+
+float FInventoryBenchmark::Weight(UInventoryComponent* Inventory, const int32 NumItems) const
+{
+	float TotalWeight = 0.f;
+	for (int32 i = 0; i < NumItems; ++i)
+	{
+		TotalWeight += Inventory->GetCurrentWeight();
+	}
+	return TotalWeight;
+}
+
+void FInventoryBenchmark::Consume(UInventoryComponent* Inventory, const int32 NumItems) const
+{
+	// Each one empties a whole slot, as the bulk of the inventory isn't stackable
+	for (int32 i = 0; i < NumItems / 2; ++i)
+	{
+		Inventory->ConsumeItemsByClass(SingleClasses[i % SingleClasses.Num()], 1);
+	}
+}
+
+void FInventoryBenchmark::Remove(UInventoryComponent* Inventory) const
+{
+	for (UItem* Item : Inventory->GetItems())
+	{
+		Inventory->RemoveItem(Item);
+	}
+
+	// Lightweight stacks have no item object to remove, so take whatever is left by class
+	for (const TArray<TSubclassOf<UItem>>* Classes : { &StackableClasses, &SingleClasses })
+	{
+		for (const TSubclassOf<UItem>& ItemClass : *Classes)
+		{
+			Inventory->ConsumeItemsByClass(ItemClass, Inventory->GetItemQuantity(ItemClass));
+		}
+	}
+}
+
+FString FInventoryBenchmark::ToCsv(const TArray<FInventoryBenchmarkResult>& Results)
+{
+	FString Csv = TEXT("Items,Slots,AddMs,FindMs,WeightMs,ConsumeMs,RemoveMs\n");
+	for (const FInventoryBenchmarkResult& Result : Results)
+	{
+		Csv += FString::Printf(TEXT("%d,%d,%.4f,%.4f,%.4f,%.4f,%.4f\n"),
+			Result.NumItems, Result.NumSlots, Result.AddMs, Result.FindMs, Result.WeightMs, Result.ConsumeMs, Result.RemoveMs);
+	}
+	return Csv;
+}
@@ -0,0 +1,58 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Items/Item.h"
+#include "InventoryBenchmark.generated.h"
+
+class UInventoryComponent;
+
+// Non stackable item the inventory benchmark falls back to, so it can always fill one slot per add. Not meant for gameplay.
+UCLASS(NotBlueprintable, HideDropdown)
+class SURVIVALGAME_API UInventoryBenchmarkItem : public UItem
+{
+	GENERATED_BODY()
+
+public:
+	UInventoryBenchmarkItem();
+};
+
+struct FInventoryBenchmarkResult
+{
+	int32 NumItems = 0;
+	int32 NumSlots = 0;
+	double AddMs = 0.0;
+	double FindMs = 0.0;
+	double WeightMs = 0.0;
+	double ConsumeMs = 0.0;
+	double RemoveMs = 0.0;
+};
+
+/**
+ * Times add, find, weight, consume and remove on an inventory of a given size. Shared by the BenchmarkInventory cheat and the
+ * SurvivalGame.Inventory.Benchmark automation test.
+ *
+ * Stackable classes only ever get one stack, so each of them is added once as a full stack and every other add is a non stackable
+ * item. That way N adds fill roughly N slots.
+ */
+struct SURVIVALGAME_API FInventoryBenchmark
+{
+	FInventoryBenchmark(const TArray<TSubclassOf<UItem>>& ItemClasses);
+
+	// Runs every operation once on an empty inventory with authority, leaving it empty again.
+	FInventoryBenchmarkResult Run(UInventoryComponent* Inventory, const int32 NumItems) const;
+
+	// Individual operations, for measuring each one on its own. Add fills the inventory, Consume takes half of it, Remove empties it.
+	void Add(UInventoryComponent* Inventory, const int32 NumItems) const;
+	void Find(UInventoryComponent* Inventory, const int32 NumItems) const;
+	float Weight(UInventoryComponent* Inventory, const int32 NumItems) const;
+	void Consume(UInventoryComponent* Inventory, const int32 NumItems) const;
+	void Remove(UInventoryComponent* Inventory) const;
+
+	static FString ToCsv(const TArray<FInventoryBenchmarkResult>& Results);
+
+private:
+	TArray<TSubclassOf<UItem>> StackableClasses;
+	TArray<TSubclassOf<UItem>> SingleClasses;
+};
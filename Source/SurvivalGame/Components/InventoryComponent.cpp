@@ -2,29 +2,97 @@
 
 
 #include "Components/InventoryComponent.h"
+#include "SurvivalGame.h"
 #include "Items/Item.h"
+#include "Items/ItemPoolSubsystem.h"
+#include "Components/InventorySnapshot.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "Net/DataBunch.h"
 #include "Engine/ActorChannel.h" // to replicate UObjects
+#include "ProfilingDebugging/CsvProfiler.h"
 
 #define LOCTEXT_NAMESPACE "Inventory"
 
+DECLARE_CYCLE_STAT(TEXT("Inventory TryAddItem"), STAT_InventoryTryAddItem, STATGROUP_SurvivalGame);
+DECLARE_CYCLE_STAT(TEXT("Inventory ConsumeItem"), STAT_InventoryConsumeItem, STATGROUP_SurvivalGame);
+DECLARE_CYCLE_STAT(TEXT("Inventory RemoveItem"), STAT_InventoryRemoveItem, STATGROUP_SurvivalGame);
+DECLARE_CYCLE_STAT(TEXT("Inventory FindItem"), STAT_InventoryFindItem, STATGROUP_SurvivalGame);
+DECLARE_CYCLE_STAT(TEXT("Inventory QueryItems"), STAT_InventoryQueryItems, STATGROUP_SurvivalGame);
+DECLARE_CYCLE_STAT(TEXT("Inventory GetCurrentWeight"), STAT_InventoryGetCurrentWeight, STATGROUP_SurvivalGame);
+DECLARE_CYCLE_STAT(TEXT("Inventory ReplicateSubobjects"), STAT_InventoryReplicateSubobjects, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Inventory Replicated Bytes"), STAT_InventoryReplicatedBytes, STATGROUP_SurvivalGame);
+
+// Run with -csvprofile (or csvprofile start/stop) to capture these per frame, so builds can be compared.
+CSV_DEFINE_CATEGORY(Inventory, true);
+
 // Sets default values for this component's properties
-UInventoryComponent::UInventoryComponent()
+UInventoryComponent::UInventoryComponent() :
+	bItemClassIndexDirty(false), CurrentWeight(0.f), bCurrentWeightDirty(false), bItemAttributesDirty(true), PendingUpdateFlags(EInventoryUpdateFlags::None),
+	LastUpdateFlags(EInventoryUpdateFlags::None), BatchDepth(0), bBatchNeedsReplication(false), bBatchArrayChanged(false), ReplicatedBytes(0)
 {
 	SetIsReplicated(true);	// other players will see each others' inventory etc. 
+
+	Items.OwnerComponent = this;
 }
 
 FItemAddResult UInventoryComponent::TryAddItem(UItem* Item)
 {
-	return TryAddItem_Internal(Item);
+	return TryAddItem_Internal(Item, Item->GetQuantity());
 }
 
 FItemAddResult UInventoryComponent::TryAddItemFromClass(TSubclassOf<class UItem> ItemClass, const int32 Quantity)
 {
-	UItem* Item = NewObject<UItem>(GetOwner(), ItemClass);
-	Item->SetQuantity(Quantity);
+	if (!ItemClass)
+	{
+		return FItemAddResult::AddedNone(Quantity, LOCTEXT("InventoryErrorText", "Couldn't add item to Inventory."));
+	}
+
+	// The class defaults have everything we need to know about the item, no need to create a throwaway instance of it.
+	const UItem* ItemDefinition = GetDefault<UItem>(ItemClass);
+	const int32 ClampedQuantity = FMath::Clamp(Quantity, 0, ItemDefinition->GetIsStackable() ? ItemDefinition->GetMaxStackSize() : 1);
 
-	return TryAddItem_Internal(Item);
+	return TryAddItem_Internal(ItemDefinition, ClampedQuantity);
+}
+
+TArray<FItemAddResult> UInventoryComponent::TryAddItems(const TArray<UItem*>& ItemsToAdd)
+{
+	TArray<FItemAddResult> Results;
+	Results.Reserve(ItemsToAdd.Num());
+
+	FInventoryBatchScope Batch(this);
+
+	/** Once the inventory is out of slots or weight, the rest of the batch is turned away without going through TryAddItem_Internal().
+	 * Both totals are cached, so keeping these up to date after every add is cheap. */
+	bool bSlotsFull = GetNumUsedSlots() >= GetCapacity();
+	bool bWeightFull = GetCurrentWeight() >= GetWeightCapacity();
+
+	for (UItem* Item : ItemsToAdd)
+	{
+		if (!Item)
+		{
+			Results.Add(FItemAddResult::AddedNone(0, LOCTEXT("InventoryErrorText", "Couldn't add item to Inventory.")));
+		}
+		else if (bSlotsFull)
+		{
+			Results.Add(FItemAddResult::AddedNone(Item->GetQuantity(), LOCTEXT("InventoryCapacityFullText", "Couldn't add item to Inventory. Inventory is full.")));
+		}
+		else if (bWeightFull && !FMath::IsNearlyZero(Item->GetWeight()))
+		{
+			Results.Add(FItemAddResult::AddedNone(Item->GetQuantity(), LOCTEXT("InventoryTooMuchWeightText", "Couldn't add item to Inventory. Carrying too much weight.")));
+		}
+		else
+		{
+			const FItemAddResult& Result = Results.Add_GetRef(TryAddItem_Internal(Item, Item->GetQuantity()));
+
+			if (Result.ActualAmountGiven > 0)
+			{
+				bSlotsFull = GetNumUsedSlots() >= GetCapacity();
+				bWeightFull = GetCurrentWeight() >= GetWeightCapacity();
+			}
+		}
+	}
+	return Results;
 }
 
 int32 UInventoryComponent::ConsumeItem(UItem* Item)
@@ -38,6 +106,9 @@ int32 UInventoryComponent::ConsumeItem(UItem* Item)
 
 int32 UInventoryComponent::ConsumeItem(UItem* Item, const int32 Quantity)
 {
+	SCOPE_CYCLE_COUNTER(STAT_InventoryConsumeItem);
+	CSV_SCOPED_TIMING_STAT(Inventory, ConsumeItem);
+
 	if (GetOwner() && GetOwner()->HasAuthority() && Item)
 	{
 		const int32 RemoveQuantity = FMath::Min(Quantity, Item->GetQuantity());
@@ -48,14 +119,11 @@ int32 UInventoryComponent::ConsumeItem(UItem* Item, const int32 Quantity)
 		// we now have zero of this item, remove from the inventory
 		Item->SetQuantity(Item->GetQuantity() - RemoveQuantity);
 
+		// The new quantity reaches the client through the item's inventory entry, no need to tell it to refresh.
 		if (Item->GetQuantity() <= 0)
 		{
 			RemoveItem(Item);
 		}
-		else
-		{
-			ClientRefreshInventory();
-		}
 		return RemoveQuantity;
 	}
 	return 0;
@@ -63,12 +131,23 @@ int32 UInventoryComponent::ConsumeItem(UItem* Item, const int32 Quantity)
 
 bool UInventoryComponent::RemoveItem(UItem* Item)
 {
+	SCOPE_CYCLE_COUNTER(STAT_InventoryRemoveItem);
+	CSV_SCOPED_TIMING_STAT(Inventory, RemoveItem);
+
 	if (GetOwner() && GetOwner()->HasAuthority())
 	{
 		if (Item)
 		{
-			Items.RemoveSingle(Item);
-			ReplicatedItemsKey++;
+			const int32 Slot = FindItemSlot(Item);
+
+			if (Slot != INDEX_NONE)
+			{
+				RemoveEntryAt(Slot);
+			}
+			else
+			{
+				MarkItemsDirtyForReplication(true);
+			}
 
 			return true;
 		}
@@ -77,97 +156,468 @@ bool UInventoryComponent::RemoveItem(UItem* Item)
 	return false;
 }
 
+int32 UInventoryComponent::ConsumeItemsByClass(TSubclassOf<UItem> ItemClass, const int32 Quantity)
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryConsumeItem);
+	CSV_SCOPED_TIMING_STAT(Inventory, ConsumeItem);
+
+	if (GetOwner() && GetOwner()->HasAuthority() && ItemClass)
+	{
+		FInventoryBatchScope Batch(this);
+
+		int32 RemainingQuantity = Quantity;
+
+		while (RemainingQuantity > 0)
+		{
+			const TArray<int32>* Slots = ItemClassIndex.Find(*ItemClass);
+			if (!Slots)
+			{
+				break;
+			}
+
+			// Take from the last stack first, so emptying it doesn't shift the slots of the ones we still need to visit.
+			const int32 Slot = Slots->Last();
+			const int32 StackQuantity = Items.Entries[Slot].Quantity;
+			const int32 RemoveQuantity = FMath::Min(RemainingQuantity, StackQuantity);
+
+			RemainingQuantity -= RemoveQuantity;
+
+			if (RemoveQuantity >= StackQuantity)
+			{
+				RemoveEntryAt(Slot);
+			}
+			else
+			{
+				SetStackQuantity(Slot, StackQuantity - RemoveQuantity);
+			}
+		}
+		return Quantity - RemainingQuantity;
+	}
+	return 0;
+}
+
+int32 UInventoryComponent::RemoveItems(const TArray<UItem*>& ItemsToRemove)
+{
+	FInventoryBatchScope Batch(this);
+
+	int32 NumRemoved = 0;
+
+	for (UItem* Item : ItemsToRemove)
+	{
+		if (RemoveItem(Item))
+		{
+			++NumRemoved;
+		}
+	}
+	return NumRemoved;
+}
+
+void UInventoryComponent::BeginBatch()
+{
+	++BatchDepth;
+}
+
+void UInventoryComponent::EndBatch()
+{
+	check(BatchDepth > 0);
+
+	if (--BatchDepth > 0)
+	{
+		return;
+	}
+
+	if (bBatchNeedsReplication)
+	{
+		MarkItemsDirtyForReplication(bBatchArrayChanged);
+	}
+
+	bBatchNeedsReplication = false;
+	bBatchArrayChanged = false;
+}
+
 bool UInventoryComponent::HasItem(TSubclassOf<UItem> ItemClass, const int32 Quantity) const
 {
-	if (UItem* ItemToFind = FindItemByClass(ItemClass))
+	const int32 Slot = FindStackSlot(ItemClass);
+
+	if (Slot != INDEX_NONE)
 	{
-		return ItemToFind->GetQuantity() >= Quantity;
+		return Items.Entries[Slot].Quantity >= Quantity;
 	}
 	return false;
 }
 
-UItem* UInventoryComponent::FindItem(UItem* Item) const
+int32 UInventoryComponent::GetItemQuantity(TSubclassOf<UItem> ItemClass) const
 {
-	if (Item)
+	EnsureItemClassIndex();
+
+	int32 TotalQuantity = 0;
+
+	if (const TArray<int32>* Slots = ItemClassIndex.Find(*ItemClass))
 	{
-		for (auto& InvItem : Items)
+		for (const int32 Slot : *Slots)
 		{
-			if (InvItem && InvItem->GetClass() == Item->GetClass())
-			{
-				return InvItem;
-			}
+			TotalQuantity += Items.Entries[Slot].Quantity;
 		}
 	}
+	return TotalQuantity;
+}
+
+UItem* UInventoryComponent::FindItem(UItem* Item) const
+{
+	if (Item)
+	{
+		return FindItemByClass(Item->GetClass());
+	}
 	return nullptr;
 }
 
 UItem* UInventoryComponent::FindItemByClass(TSubclassOf<UItem> ItemClass) const
 {
-	for (auto& InvItem : Items)
+	const int32 Slot = FindStackSlot(ItemClass);
+
+	if (Slot != INDEX_NONE)
 	{
-		if (InvItem && InvItem->GetClass() == ItemClass)
-		{
-			return InvItem;
-		}
+		return Items.Entries[Slot].Item;
 	}
 	return nullptr;
 }
 
 TArray<UItem*> UInventoryComponent::FindItemsByClass(TSubclassOf<UItem> ItemClass) const
 {
+	SCOPE_CYCLE_COUNTER(STAT_InventoryFindItem);
+
 	TArray<UItem*> ItemsOfClass;
 
-	for (auto& InvItem : Items)
+	if (!ItemClass)
 	{
-		if (InvItem && InvItem->GetClass()->IsChildOf(ItemClass))
+		return ItemsOfClass;
+	}
+
+	EnsureItemClassIndex();
+
+	// Only walk the distinct classes we hold instead of every item.
+	TArray<int32> MatchingSlots;
+
+	for (const auto& ClassSlots : ItemClassIndex)
+	{
+		if (ClassSlots.Key->IsChildOf(ItemClass))
 		{
-			ItemsOfClass.Add(InvItem);
+			MatchingSlots.Append(ClassSlots.Value);
+		}
+	}
+
+	// Keep the same order as the inventory.
+	MatchingSlots.Sort();
+
+	ItemsOfClass.Reserve(MatchingSlots.Num());
+	for (const int32 Slot : MatchingSlots)
+	{
+		// Lightweight stacks don't have an item instance to return.
+		if (UItem* Item = Items.Entries[Slot].Item)
+		{
+			ItemsOfClass.Add(Item);
 		}
 	}
 	return ItemsOfClass;
 }
 
-float UInventoryComponent::GetCurrentWeight() const
+void UInventoryComponent::QueryItems(const FInventoryQuery& Query, TArray<UItem*>& OutItems) const
 {
-	float weight = 0.f;
+	OutItems.Reset();
 
-	for (auto& Item : Items)
+	QueryItemSlots(Query, QuerySlotsScratch);
+
+	for (const int32 Slot : QuerySlotsScratch)
 	{
-		if (Item)
+		if (UItem* Item = Items.Entries[Slot].Item)
 		{
-			weight += Item->GetStackWeight();
+			OutItems.Add(Item);
 		}
 	}
+}
 
-	return weight;
+void UInventoryComponent::QueryItemSlots(const FInventoryQuery& Query, TArray<int32>& OutSlots) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryQueryItems);
+
+	OutSlots.Reset();
+	EnsureItemAttributes();
+
+	const FItemAttributeMirror& Attributes = ItemAttributes;
+	const UClass* QueryClass = Query.ItemClass;
+	const bool bAnyStackable = Query.Stackable == EInventoryStackableFilter::ISF_ANY;
+	const bool bWantStackable = Query.Stackable == EInventoryStackableFilter::ISF_STACKABLE;
+
+	for (int32 Slot = 0; Slot < Attributes.Classes.Num(); ++Slot)
+	{
+		if (!Attributes.Classes[Slot])
+		{
+			continue;
+		}
+
+		if (Attributes.Rarities[Slot] < Query.MinRarity || Attributes.Rarities[Slot] > Query.MaxRarity)
+		{
+			continue;
+		}
+
+		if (Query.MaxWeight > 0.f && Attributes.Weights[Slot] > Query.MaxWeight)
+		{
+			continue;
+		}
+
+		if (!bAnyStackable && Attributes.Stackable[Slot] != bWantStackable)
+		{
+			continue;
+		}
+
+		// Class check last, it's the only one that has to leave the mirror
+		if (QueryClass && !Attributes.Classes[Slot]->IsChildOf(QueryClass))
+		{
+			continue;
+		}
+
+		OutSlots.Add(Slot);
+	}
+
+	if (Query.SortBy != EInventorySortKey::ISK_NONE)
+	{
+		const bool bDescending = Query.bDescending;
+		auto SortBy = [bDescending](auto Key)
+		{
+			return [bDescending, Key](const int32 A, const int32 B)
+			{
+				// Ties stay in slot order, so sorting is stable from one query to the next
+				const auto KeyA = Key(A);
+				const auto KeyB = Key(B);
+				if (KeyA == KeyB)
+				{
+					return A < B;
+				}
+				return bDescending ? KeyB < KeyA : KeyA < KeyB;
+			};
+		};
+
+		switch (Query.SortBy)
+		{
+		case EInventorySortKey::ISK_RARITY:
+			OutSlots.Sort(SortBy([&Attributes](const int32 Slot) { return Attributes.Rarities[Slot]; }));
+			break;
+		case EInventorySortKey::ISK_WEIGHT:
+			OutSlots.Sort(SortBy([&Attributes](const int32 Slot) { return Attributes.Weights[Slot]; }));
+			break;
+		case EInventorySortKey::ISK_STACKWEIGHT:
+			OutSlots.Sort(SortBy([&Attributes](const int32 Slot) { return Attributes.Weights[Slot] * Attributes.Quantities[Slot]; }));
+			break;
+		case EInventorySortKey::ISK_QUANTITY:
+			OutSlots.Sort(SortBy([&Attributes](const int32 Slot) { return Attributes.Quantities[Slot]; }));
+			break;
+		default:
+			break;
+		}
+	}
+
+	if (Query.MaxResults > 0 && OutSlots.Num() > Query.MaxResults)
+	{
+		OutSlots.SetNum(Query.MaxResults, false);
+	}
+}
+
+float UInventoryComponent::GetCurrentWeight() const
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryGetCurrentWeight);
+
+	if (bCurrentWeightDirty)
+	{
+		CurrentWeight = CalculateCurrentWeight();
+		bCurrentWeightDirty = false;
+	}
+
+	return CurrentWeight;
+}
+
+TArray<UItem*> UInventoryComponent::GetItems() const
+{
+	TArray<UItem*> ItemList;
+	ItemList.Reserve(Items.Num());
+
+	for (const FInventoryItemEntry& Entry : Items.Entries)
+	{
+		if (Entry.Item)
+		{
+			ItemList.Add(Entry.Item);
+		}
+	}
+	return ItemList;
 }
 
 void UInventoryComponent::SetWeightCapacity(const float NewWeightCapacity)
 {
 	WeightCapacity = NewWeightCapacity;
-	OnInventoryUpdated.Broadcast();
+	NotifyInventoryUpdated(EInventoryUpdateFlags::Capacity);
 }
 
 void UInventoryComponent::SetCapacity(const int32 NewCapacity)
 {
 	Capacity = NewCapacity;
-	OnInventoryUpdated.Broadcast();
+	NotifyInventoryUpdated(EInventoryUpdateFlags::Capacity);
 }
 
-void UInventoryComponent::ClientRefreshInventory_Implementation()
+void UInventoryComponent::CaptureSnapshot(FInventorySnapshot& OutSnapshot) const
 {
-	OnInventoryUpdated.Broadcast();
+	OutSnapshot.Reset();
+	OutSnapshot.Capacity = Capacity;
+	OutSnapshot.WeightCapacity = WeightCapacity;
+	OutSnapshot.Stacks.Reserve(Items.Num());
+
+	TMap<UClass*, int32, TInlineSetAllocator<16>> ClassTable;
+
+	for (const FInventoryItemEntry& Entry : Items.Entries)
+	{
+		if (UClass* ItemClass = Entry.ItemClass)
+		{
+			int32* ClassIndex = ClassTable.Find(ItemClass);
+			if (!ClassIndex)
+			{
+				ClassIndex = &ClassTable.Add(ItemClass, OutSnapshot.ItemClasses.Add(FSoftClassPath(ItemClass)));
+			}
+
+			FInventorySnapshot::FStack& Stack = OutSnapshot.Stacks.AddDefaulted_GetRef();
+			Stack.ClassIndex = *ClassIndex;
+			Stack.Quantity = Entry.Quantity;
+		}
+	}
+}
+
+bool UInventoryComponent::ApplySnapshot(const FInventorySnapshot& Snapshot)
+{
+	AActor* Owner = GetOwner();
+	if (!Owner || !Owner->HasAuthority())
+	{
+		return false;
+	}
+
+	// Classes are usually loaded already since something in the world uses them, so this rarely hits the disk.
+	TArray<UClass*, TInlineAllocator<16>> ItemClasses;
+	for (const FSoftClassPath& ClassPath : Snapshot.ItemClasses)
+	{
+		UClass* ItemClass = ClassPath.TryLoadClass<UItem>();
+		if (!ItemClass)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Inventory snapshot references missing item class %s, dropping its stacks"), *ClassPath.ToString());
+		}
+		ItemClasses.Add(ItemClass);
+	}
+
+	// Drop the current contents quietly, the single update at the end covers them
+	for (const FInventoryItemEntry& Entry : Items.Entries)
+	{
+		if (UItem* Item = Entry.Item)
+		{
+			Item->SetOwningInventory(nullptr);
+			UItemPoolSubsystem::Release(Item);
+		}
+	}
+	Items.Entries.Reset(Snapshot.Stacks.Num());
+
+	Capacity = Snapshot.Capacity;
+	WeightCapacity = Snapshot.WeightCapacity;
+
+	for (const FInventorySnapshot::FStack& Stack : Snapshot.Stacks)
+	{
+		UClass* ItemClass = ItemClasses.IsValidIndex(Stack.ClassIndex) ? ItemClasses[Stack.ClassIndex] : nullptr;
+		if (!ItemClass || Stack.Quantity <= 0)
+		{
+			continue;
+		}
+
+		const UItem* ItemDefaults = GetDefault<UItem>(ItemClass);
+		const int32 Quantity = FMath::Clamp(Stack.Quantity, 1, ItemDefaults->GetIsStackable() ? ItemDefaults->GetMaxStackSize() : 1);
+
+		// Same rules as AddItem(), minus the per item broadcasts and replication
+		UItem* NewItem = nullptr;
+		if (!bUseLightweightStacks || ItemDefaults->RequiresInstance())
+		{
+			NewItem = UItemPoolSubsystem::Acquire(Owner, ItemClass);
+			NewItem->SetQuantity(Quantity);
+			NewItem->SetOwningInventory(this);
+			NewItem->AddedToInventory(this);
+		}
+
+		const int32 Slot = Items.Entries.Emplace(ItemClass, NewItem, Quantity);
+		Items.MarkItemDirty(Items.Entries[Slot]);
+	}
+
+	RebuildItemClassIndex();
+	bItemClassIndexDirty = false;
+
+	CurrentWeight = CalculateCurrentWeight();
+	bCurrentWeightDirty = false;
+
+	MarkItemsDirtyForReplication(true);
+	NotifyInventoryUpdated(EInventoryUpdateFlags::Items | EInventoryUpdateFlags::Weight | EInventoryUpdateFlags::Capacity);
+
+	return true;
+}
+
+void UInventoryComponent::SaveInventory(const FString& SlotName)
+{
+	FInventorySnapshot Snapshot;
+	CaptureSnapshot(Snapshot);
+
+	FInventorySnapshot::SaveToFileAsync(MoveTemp(Snapshot), GetInventorySavePath(SlotName), [SlotName](bool bSuccess)
+	{
+		if (!bSuccess)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to save inventory %s"), *SlotName);
+		}
+	});
+}
+
+void UInventoryComponent::LoadInventory(const FString& SlotName)
+{
+	if (!GetOwner() || !GetOwner()->HasAuthority())
+	{
+		return;
+	}
+
+	TWeakObjectPtr<UInventoryComponent> WeakThis(this);
+	FInventorySnapshot::LoadFromFileAsync(GetInventorySavePath(SlotName), [WeakThis, SlotName](bool bSuccess, FInventorySnapshot&& Snapshot)
+	{
+		if (!bSuccess)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Failed to load inventory %s"), *SlotName);
+			return;
+		}
+
+		if (UInventoryComponent* Inventory = WeakThis.Get())
+		{
+			Inventory->ApplySnapshot(Snapshot);
+		}
+	});
+}
+
+FString UInventoryComponent::GetInventorySavePath(const FString& SlotName)
+{
+	return FPaths::ProjectSavedDir() / TEXT("Inventories") / SlotName + TEXT(".inv");
 }
 
 void UInventoryComponent::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UInventoryComponent, Items);
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UInventoryComponent, Items, Params);
 }
 
 bool UInventoryComponent::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
 {
+	SCOPE_CYCLE_COUNTER(STAT_InventoryReplicateSubobjects);
+	CSV_SCOPED_TIMING_STAT(Inventory, ReplicateSubobjects);
+
+	const int64 StartBits = Bunch->GetNumBits();
+
 	bool bWroteSomething = Super::ReplicateSubobjects(Channel, Bunch, RepFlags); // whether or not we wrote something to actor channel
 
 	/* Typically for anything that isn't a UObject, just using DOREPLIFETIME along with UPROPERTY(Replicated)
@@ -178,28 +628,55 @@ bool UInventoryComponent::ReplicateSubobjects(UActorChannel* Channel, FOutBunch*
 	// Check if the array of items needs to replicate
 	if (Channel->KeyNeedsToReplicate(0, ReplicatedItemsKey))
 	{
-		for (auto& Item : Items)
+		for (auto& Entry : Items.Entries)
 		{
-			if (Channel->KeyNeedsToReplicate(Item->GetUniqueID(), Item->RepKey))	// lesson 13.
+			UItem* Item = Entry.Item;
+
+			if (Item && Channel->KeyNeedsToReplicate(Item->GetUniqueID(), Item->RepKey))	// lesson 13.
 			{
 				bWroteSomething |= Channel->ReplicateSubobject(Item, *Bunch, *RepFlags);
 			}
 		}
 	}
+
+	const int32 BytesWritten = FMath::DivideAndRoundUp<int64>(Bunch->GetNumBits() - StartBits, 8);
+	ReplicatedBytes += BytesWritten;
+	INC_DWORD_STAT_BY(STAT_InventoryReplicatedBytes, BytesWritten);
+	CSV_CUSTOM_STAT(Inventory, ReplicatedBytes, BytesWritten, ECsvCustomStatOp::Accumulate);
+
 	return bWroteSomething;
 }
 
-UItem* UInventoryComponent::AddItem(UItem* Item)
+UItem* UInventoryComponent::AddItem(const UItem* Item, const int32 Quantity)
 {
 	auto Owner = GetOwner();
 	if (Owner && Owner->HasAuthority())	// owner is the actor that has this component.
 	{
-		UItem* NewItem = NewObject<UItem>(Owner, Item->GetClass());	// Reconstructing the Item and owning this Item.
-		NewItem->SetQuantity(Item->GetQuantity());
-		NewItem->SetOwningInventory(this);
-		NewItem->AddedToInventory(this);
-		Items.Add(NewItem);
-		NewItem->MarkDirtyForReplication();
+		UItem* NewItem = nullptr;
+
+		// Lightweight stacks only get their own item object if the item needs per-instance behavior.
+		if (!bUseLightweightStacks || Item->RequiresInstance())
+		{
+			NewItem = UItemPoolSubsystem::Acquire(Owner, Item->GetClass());	// Reconstructing the Item and owning this Item.
+			NewItem->SetQuantity(Quantity);
+			NewItem->SetOwningInventory(this);
+			NewItem->AddedToInventory(this);
+		}
+
+		const int32 StackQuantity = NewItem ? NewItem->GetQuantity() : Quantity;
+		const int32 Slot = Items.Entries.Emplace(Item->GetClass(), NewItem, StackQuantity);
+		Items.MarkItemDirty(Items.Entries[Slot]);
+		MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+		AddToClassIndex(Item->GetClass(), Slot);
+		CurrentWeight += StackQuantity * Item->GetWeight();
+		VerifyCachedTotals();
+
+		if (NewItem)
+		{
+			NewItem->MarkDirtyForReplication();
+			OnItemAdded.Broadcast(NewItem);
+		}
+		NotifyInventoryUpdated(EInventoryUpdateFlags::Items | EInventoryUpdateFlags::Weight);
 
 		return NewItem;
 	}
@@ -207,19 +684,373 @@ UItem* UInventoryComponent::AddItem(UItem* Item)
 	return nullptr;
 }
 
-void UInventoryComponent::OnRep_Items()
+void UInventoryComponent::RemoveEntryAt(const int32 Slot)
+{
+	const FInventoryItemEntry RemovedEntry = Items.Entries[Slot];
+
+	Items.Entries.RemoveAt(Slot);
+	RemoveFromClassIndex(RemovedEntry.ItemClass, Slot);
+
+	// The stack no longer counts towards our weight, even if someone changes the item's quantity later on.
+	if (const UItem* ItemDefinition = RemovedEntry.GetDefinition())
+	{
+		CurrentWeight -= RemovedEntry.Quantity * ItemDefinition->GetWeight();
+	}
+	VerifyCachedTotals();
+
+	if (UItem* Item = RemovedEntry.Item)
+	{
+		Item->SetOwningInventory(nullptr);
+		OnItemRemoved.Broadcast(Item);
+	}
+
+	NotifyInventoryUpdated(EInventoryUpdateFlags::Items | EInventoryUpdateFlags::Weight);
+	MarkItemsDirtyForReplication(true);
+
+	// Give the item back to the pool once nothing should be holding on to it anymore. The pool leaves replicated items alone.
+	if (RemovedEntry.Item)
+	{
+		UItemPoolSubsystem::Release(RemovedEntry.Item);
+	}
+}
+
+void UInventoryComponent::SetStackQuantity(const int32 Slot, const int32 NewQuantity)
+{
+	FInventoryItemEntry& Entry = Items.Entries[Slot];
+
+	// Instanced items keep their entry in sync through OnItemQuantityChanged()
+	if (Entry.Item)
+	{
+		Entry.Item->SetQuantity(NewQuantity);
+		return;
+	}
+
+	if (const UItem* ItemDefinition = Entry.GetDefinition())
+	{
+		const int32 OldQuantity = Entry.Quantity;
+		Entry.Quantity = FMath::Clamp(NewQuantity, 0, ItemDefinition->GetIsStackable() ? ItemDefinition->GetMaxStackSize() : 1);
+
+		CurrentWeight += (Entry.Quantity - OldQuantity) * ItemDefinition->GetWeight();
+		VerifyCachedTotals();
+
+		Items.MarkItemDirty(Entry);
+		MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+		NotifyInventoryUpdated(EInventoryUpdateFlags::Items | EInventoryUpdateFlags::Weight);
+	}
+}
+
+const UItem* FInventoryItemEntry::GetDefinition() const
 {
+	if (Item)
+	{
+		return Item;
+	}
+	return ItemClass ? GetDefault<UItem>(ItemClass) : nullptr;
+}
+
+void FInventoryItemEntry::PreReplicatedRemove(const FInventoryItemArray& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->OnEntryReplicatedRemove(*this);
+	}
+}
+
+void FInventoryItemEntry::PostReplicatedAdd(const FInventoryItemArray& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->OnEntryReplicatedAdd(*this);
+	}
+}
+
+void FInventoryItemEntry::PostReplicatedChange(const FInventoryItemArray& InArraySerializer)
+{
+	if (InArraySerializer.OwnerComponent)
+	{
+		InArraySerializer.OwnerComponent->OnEntryReplicatedChange(*this);
+	}
+}
+
+void UInventoryComponent::OnEntryReplicatedAdd(FInventoryItemEntry& Entry)
+{
+	// The item subobject might not have resolved yet, in which case we'll get a change callback once it has.
+	if (UItem* Item = Entry.Item)
+	{
+		// Items don't replicate their owning inventory, so hook them up here so they can flag our cached weight when their quantity changes.
+		Item->SetOwningInventory(this);
+		Item->ApplyReplicatedQuantity(Entry.Quantity);
+
+		OnItemAdded.Broadcast(Item);
+	}
+
+	bItemClassIndexDirty = true;
+	MarkCurrentWeightDirty();
+	NotifyInventoryUpdated(EInventoryUpdateFlags::Items | EInventoryUpdateFlags::Weight);
+}
+
+void UInventoryComponent::OnEntryReplicatedChange(FInventoryItemEntry& Entry)
+{
+	if (UItem* Item = Entry.Item)
+	{
+		Item->SetOwningInventory(this);
+		Item->ApplyReplicatedQuantity(Entry.Quantity);
+
+		OnItemChanged.Broadcast(Item);
+	}
+
+	// The item may have only just resolved, so the index needs rebuilding too.
+	bItemClassIndexDirty = true;
+	MarkCurrentWeightDirty();
+	NotifyInventoryUpdated(EInventoryUpdateFlags::Items | EInventoryUpdateFlags::Weight);
+}
+
+void UInventoryComponent::OnEntryReplicatedRemove(FInventoryItemEntry& Entry)
+{
+	if (UItem* Item = Entry.Item)
+	{
+		Item->SetOwningInventory(nullptr);
+
+		OnItemRemoved.Broadcast(Item);
+	}
+
+	bItemClassIndexDirty = true;
+	MarkCurrentWeightDirty();
+	NotifyInventoryUpdated(EInventoryUpdateFlags::Items | EInventoryUpdateFlags::Weight);
+}
+
+int32 UInventoryComponent::FindStackSlot(TSubclassOf<UItem> ItemClass) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryFindItem);
+
+	EnsureItemClassIndex();
+
+	if (const TArray<int32>* Slots = ItemClassIndex.Find(*ItemClass))
+	{
+		// Slots are kept in order, so the first one is the same stack a scan of Items would find first.
+		return (*Slots)[0];
+	}
+	return INDEX_NONE;
+}
+
+int32 UInventoryComponent::FindItemSlot(const UItem* Item) const
+{
+	if (Item)
+	{
+		EnsureItemClassIndex();
+
+		if (const TArray<int32>* Slots = ItemClassIndex.Find(Item->GetClass()))
+		{
+			for (const int32 Slot : *Slots)
+			{
+				if (Items.Entries[Slot].Item == Item)
+				{
+					return Slot;
+				}
+			}
+		}
+	}
+	return INDEX_NONE;
+}
+
+void UInventoryComponent::AddToClassIndex(UClass* ItemClass, const int32 Slot)
+{
+	// New items are always appended, so adding to the back keeps the slots sorted.
+	ItemClassIndex.FindOrAdd(ItemClass).Add(Slot);
+}
+
+void UInventoryComponent::RemoveFromClassIndex(UClass* ItemClass, const int32 Slot)
+{
+	if (TArray<int32>* Slots = ItemClassIndex.Find(ItemClass))
+	{
+		Slots->RemoveSingle(Slot);
+
+		if (Slots->Num() == 0)
+		{
+			ItemClassIndex.Remove(ItemClass);
+		}
+	}
+
+	// Every item after the removed one moved down a slot.
+	for (auto& ClassSlots : ItemClassIndex)
+	{
+		for (int32& OtherSlot : ClassSlots.Value)
+		{
+			if (OtherSlot > Slot)
+			{
+				--OtherSlot;
+			}
+		}
+	}
+}
+
+void UInventoryComponent::EnsureItemClassIndex() const
+{
+	if (bItemClassIndexDirty)
+	{
+		RebuildItemClassIndex();
+		bItemClassIndexDirty = false;
+	}
+}
+
+void UInventoryComponent::RebuildItemClassIndex() const
+{
+	ItemClassIndex.Reset();
+
+	for (int32 Slot = 0; Slot < Items.Num(); ++Slot)
+	{
+		if (UClass* ItemClass = Items.Entries[Slot].ItemClass)
+		{
+			ItemClassIndex.FindOrAdd(ItemClass).Add(Slot);
+		}
+	}
+}
+
+void UInventoryComponent::OnItemQuantityChanged(UItem* Item, const int32 OldQuantity)
+{
+	CurrentWeight += (Item->GetQuantity() - OldQuantity) * Item->GetWeight();
+	VerifyCachedTotals();
+
+	// Only the entry needs to be resent, the item subobject itself hasn't changed
+	const int32 Slot = FindItemSlot(Item);
+	if (Slot != INDEX_NONE)
+	{
+		FInventoryItemEntry& Entry = Items.Entries[Slot];
+		Entry.Quantity = Item->GetQuantity();
+		Items.MarkItemDirty(Entry);
+		MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+
+		OnItemChanged.Broadcast(Item);
+		NotifyInventoryUpdated(EInventoryUpdateFlags::Items | EInventoryUpdateFlags::Weight);
+	}
+}
+
+void UInventoryComponent::MarkCurrentWeightDirty()
+{
+	bCurrentWeightDirty = true;
+	bItemAttributesDirty = true;
+}
+
+void UInventoryComponent::EnsureItemAttributes() const
+{
+	if (!bItemAttributesDirty)
+	{
+		return;
+	}
+
+	const int32 NumSlots = Items.Num();
+
+	// Reset keeps the allocations around, so after the first query this only allocates when the inventory grows
+	ItemAttributes.Classes.Reset(NumSlots);
+	ItemAttributes.Rarities.Reset(NumSlots);
+	ItemAttributes.Weights.Reset(NumSlots);
+	ItemAttributes.Quantities.Reset(NumSlots);
+	ItemAttributes.Stackable.Reset(NumSlots);
+
+	for (const FInventoryItemEntry& Entry : Items.Entries)
+	{
+		// Items that haven't resolved on a client yet still get a slot, but never match anything
+		const UItem* ItemDefinition = Entry.GetDefinition();
+		ItemAttributes.Classes.Add(ItemDefinition ? ItemDefinition->GetClass() : nullptr);
+		ItemAttributes.Rarities.Add(ItemDefinition ? ItemDefinition->GetRarity() : EItemRarity::IR_COMMON);
+		ItemAttributes.Weights.Add(ItemDefinition ? ItemDefinition->GetWeight() : 0.f);
+		ItemAttributes.Quantities.Add(ItemDefinition ? Entry.Quantity : 0);
+		ItemAttributes.Stackable.Add(ItemDefinition && ItemDefinition->GetIsStackable());
+	}
+
+	bItemAttributesDirty = false;
+}
+
+void UInventoryComponent::MarkItemsDirtyForReplication(const bool bArrayChanged)
+{
+	// Cheap to do more than once, and the fast array won't even be looked at without it
+	MARK_PROPERTY_DIRTY_FROM_NAME(UInventoryComponent, Items, this);
+
+	if (IsInBatch())
+	{
+		bBatchNeedsReplication = true;
+		bBatchArrayChanged |= bArrayChanged;
+		return;
+	}
+
+	if (bArrayChanged)
+	{
+		Items.MarkArrayDirty();
+	}
+	++ReplicatedItemsKey;
+}
+
+void UInventoryComponent::NotifyInventoryUpdated(const EInventoryUpdateFlags UpdateFlags)
+{
+	if (EnumHasAnyFlags(UpdateFlags, EInventoryUpdateFlags::Items))
+	{
+		bItemAttributesDirty = true;
+	}
+
+	const bool bFlushScheduled = PendingUpdateFlags != EInventoryUpdateFlags::None;
+	PendingUpdateFlags |= UpdateFlags;
+
+	if (bFlushScheduled)
+	{
+		return;
+	}
+
+	// SetCapacity() and SetWeightCapacity() get called from constructors, before there is any UI to tell.
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().SetTimerForNextTick(this, &UInventoryComponent::FlushInventoryUpdates);
+	}
+	else
+	{
+		PendingUpdateFlags = EInventoryUpdateFlags::None;
+	}
+}
+
+void UInventoryComponent::FlushInventoryUpdates()
+{
+	LastUpdateFlags = PendingUpdateFlags;
+	PendingUpdateFlags = EInventoryUpdateFlags::None;
+
 	OnInventoryUpdated.Broadcast();
+
+	LastUpdateFlags = EInventoryUpdateFlags::None;
+}
+
+float UInventoryComponent::CalculateCurrentWeight() const
+{
+	float weight = 0.f;
+
+	for (const FInventoryItemEntry& Entry : Items.Entries)
+	{
+		if (const UItem* ItemDefinition = Entry.GetDefinition())
+		{
+			weight += Entry.Quantity * ItemDefinition->GetWeight();
+		}
+	}
+
+	return weight;
 }
 
-FItemAddResult UInventoryComponent::TryAddItem_Internal(UItem* Item)
+void UInventoryComponent::VerifyCachedTotals() const
 {
+#if DO_GUARD_SLOW
+	if (!bCurrentWeightDirty)
+	{
+		const float RecalculatedWeight = CalculateCurrentWeight();
+		ensureMsgf(FMath::IsNearlyEqual(CurrentWeight, RecalculatedWeight, 0.01f), TEXT("Cached inventory weight %f doesn't match recalculated weight %f"), CurrentWeight, RecalculatedWeight);
+	}
+#endif
+}
+
+FItemAddResult UInventoryComponent::TryAddItem_Internal(const UItem* Item, const int32 AddAmount)
+{
+	SCOPE_CYCLE_COUNTER(STAT_InventoryTryAddItem);
+	CSV_SCOPED_TIMING_STAT(Inventory, TryAddItem);
+
 	auto Owner = GetOwner();
 	if (Owner && Owner->HasAuthority())
 	{
-		const int32 AddAmount = Item->GetQuantity();
-
-		if (Items.Num() + 1 > GetCapacity())
+		if (GetNumUsedSlots() + 1 > GetCapacity())
 		{
 			return FItemAddResult::AddedNone(AddAmount, LOCTEXT("InventoryCapacityFullText", "Couldn't add item to Inventory. Inventory is full."));
 		}
@@ -236,14 +1067,18 @@ FItemAddResult UInventoryComponent::TryAddItem_Internal(UItem* Item)
 		// If the item is stackable, check if we already have it and add it to their stack
 		if (Item->GetIsStackable())
 		{
-			ensure(Item->GetQuantity() <= Item->GetMaxStackSize());
+			ensure(AddAmount <= Item->GetMaxStackSize());
+
+			const int32 ExistingSlot = FindStackSlot(Item->GetClass());
 
-			if (UItem* ExistingItem = FindItem(Item))
+			if (ExistingSlot != INDEX_NONE)
 			{
-				if (ExistingItem->GetQuantity() < ExistingItem->GetMaxStackSize())
+				const int32 ExistingQuantity = Items.Entries[ExistingSlot].Quantity;
+
+				if (ExistingQuantity < Item->GetMaxStackSize())
 				{
 					// Find out how much item can be added more
-					const int32 CapacityMaxAddAmount = ExistingItem->GetMaxStackSize() - ExistingItem->GetQuantity();
+					const int32 CapacityMaxAddAmount = Item->GetMaxStackSize() - ExistingQuantity;
 					int32 ActualAddAmount = FMath::Min(AddAmount, CapacityMaxAddAmount);
 
 					FText ErrorText = LOCTEXT("InventoryErrorText", "Couldn't add al of the item to your inventory.");
@@ -272,10 +1107,10 @@ FItemAddResult UInventoryComponent::TryAddItem_Internal(UItem* Item)
 						return FItemAddResult::AddedNone(AddAmount, LOCTEXT("InventoryErrorText", "Couldn't add item to Inventory."));
 					}
 
-					ExistingItem->SetQuantity(ExistingItem->GetQuantity() + ActualAddAmount);
+					SetStackQuantity(ExistingSlot, ExistingQuantity + ActualAddAmount);
 
 					// If we somehow get more of the item than the max stack size then something is wrong with our math.
-					ensure(ExistingItem->GetQuantity() <= ExistingItem->GetMaxStackSize());
+					ensure(Items.Entries[ExistingSlot].Quantity <= Item->GetMaxStackSize());
 
 					if (ActualAddAmount < AddAmount)
 					{
@@ -294,16 +1129,16 @@ FItemAddResult UInventoryComponent::TryAddItem_Internal(UItem* Item)
 			else
 			{
 				// Since we don't have any of this item, we'll add the full stack.
-				AddItem(Item);
+				AddItem(Item, AddAmount);
 				return FItemAddResult::AddedAll(AddAmount);
 			}
 		}
 		else // item is not stackable
 		{
 			// None-stackables should always have a quantity of 1.
-			ensure(Item->GetQuantity() == 1);
+			ensure(AddAmount == 1);
 
-			AddItem(Item);
+			AddItem(Item, AddAmount);
 			return FItemAddResult::AddedAll(AddAmount);
 		}
 	}
@@ -4,11 +4,32 @@
 
 #include "CoreMinimal.h"
 #include "Components/ActorComponent.h"
+#include "Engine/NetSerialization.h"
+#include "Items/Item.h"
 #include "InventoryComponent.generated.h"
 
-// Called when the inventory is changed and the UI needs an update.
+class UItem;
+class UInventoryComponent;
+struct FInventorySnapshot;
+
+// Called when the inventory is changed and the UI needs an update. Broadcast at most once per frame.
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnInventoryUpdated);
 
+// Fine grained versions of OnInventoryUpdated, for UI that only wants to touch the entry that changed.
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInventoryItemAdded, UItem*, Item);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInventoryItemRemoved, UItem*, Item);
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnInventoryItemChanged, UItem*, Item);
+
+// What changed since the last OnInventoryUpdated broadcast.
+enum class EInventoryUpdateFlags : uint8
+{
+	None		= 0,
+	Items		= 1 << 0,
+	Weight		= 1 << 1,
+	Capacity	= 1 << 2
+};
+ENUM_CLASS_FLAGS(EInventoryUpdateFlags);
+
 UENUM(BlueprintType)
 enum class EItemAddResult : uint8
 {
@@ -17,6 +38,63 @@ enum class EItemAddResult : uint8
 	IAR_ALLITEMSADDED	UMETA(DisplayName = "All items added")
 };
 
+UENUM(BlueprintType)
+enum class EInventorySortKey : uint8
+{
+	ISK_NONE			UMETA(DisplayName = "None"),
+	ISK_RARITY			UMETA(DisplayName = "Rarity"),
+	ISK_WEIGHT			UMETA(DisplayName = "Weight"),
+	ISK_STACKWEIGHT		UMETA(DisplayName = "Stack Weight"),
+	ISK_QUANTITY		UMETA(DisplayName = "Quantity")
+};
+
+UENUM(BlueprintType)
+enum class EInventoryStackableFilter : uint8
+{
+	ISF_ANY				UMETA(DisplayName = "Any"),
+	ISF_STACKABLE		UMETA(DisplayName = "Stackable"),
+	ISF_NOTSTACKABLE	UMETA(DisplayName = "Not Stackable")
+};
+
+/** Filters and sort order for UInventoryComponent::QueryItems(), e.g. "all food, heaviest first". */
+USTRUCT(BlueprintType)
+struct FInventoryQuery
+{
+	GENERATED_BODY()
+
+public:
+	FInventoryQuery() : MinRarity(EItemRarity::IR_COMMON), MaxRarity(EItemRarity::IR_LEGENDARY), MaxWeight(0.f),
+		Stackable(EInventoryStackableFilter::ISF_ANY), SortBy(EInventorySortKey::ISK_NONE), bDescending(false), MaxResults(0) {};
+
+	// Only match items of this class or its children. Leave empty to match every class.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Query")
+	TSubclassOf<UItem> ItemClass;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Query")
+	EItemRarity MinRarity;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Query")
+	EItemRarity MaxRarity;
+
+	// Only match items weighing at most this much each. 0 means no limit.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Query", meta = (ClampMin = 0.0))
+	float MaxWeight;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Query")
+	EInventoryStackableFilter Stackable;
+
+	// Results are in slot order if this is None.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Query")
+	EInventorySortKey SortBy;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Query")
+	bool bDescending;
+
+	// Stop after this many results, after sorting. 0 means no limit.
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Query", meta = (ClampMin = 0))
+	int32 MaxResults;
+};
+
 /** Represents the result of adding an item to the inventory. */
 USTRUCT(BlueprintType)	// this can be used in blueprint as well as in cpp.
 struct FItemAddResult
@@ -69,12 +147,77 @@ public:
 	}
 };
 
+/** A single stack in the inventory. Replicated as part of a fast array so that only changed entries go over the wire.
+ * Item is only set for items that have their own object. Lightweight stacks just reference the shared class defaults of ItemClass. */
+USTRUCT()
+struct FInventoryItemEntry : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+public:
+	FInventoryItemEntry() : Item(nullptr), Quantity(0) {};
+	FInventoryItemEntry(TSubclassOf<UItem> InItemClass, UItem* InItem, const int32 InQuantity) : ItemClass(InItemClass), Item(InItem), Quantity(InQuantity) {};
+
+	// The item instance if there is one, otherwise the class defaults shared by every stack of this item.
+	const UItem* GetDefinition() const;
+
+	// [client] Fast array callbacks, these forward to the owning inventory.
+	void PreReplicatedRemove(const struct FInventoryItemArray& InArraySerializer);
+	void PostReplicatedAdd(const struct FInventoryItemArray& InArraySerializer);
+	void PostReplicatedChange(const struct FInventoryItemArray& InArraySerializer);
+
+public:
+	UPROPERTY()
+	TSubclassOf<UItem> ItemClass;
+
+	UPROPERTY()
+	UItem* Item;
+
+	// Mirrors the quantity of Item. Stack changes only mark this entry dirty, so the item itself doesn't need to be resent.
+	UPROPERTY()
+	int32 Quantity;
+};
+
+/** The replicated list of items in an inventory. */
+USTRUCT()
+struct FInventoryItemArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+public:
+	FInventoryItemArray() : OwnerComponent(nullptr) {};
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FInventoryItemEntry, FInventoryItemArray>(Entries, DeltaParms, *this);
+	}
+
+	FORCEINLINE int32 Num() const { return Entries.Num(); }
+
+public:
+	UPROPERTY()
+	TArray<FInventoryItemEntry> Entries;
+
+	// Not a UPROPERTY on purpose, otherwise instances would copy the archetype's pointer. Set in UInventoryComponent's constructor.
+	UInventoryComponent* OwnerComponent;
+};
+
+template<>
+struct TStructOpsTypeTraits<FInventoryItemArray> : public TStructOpsTypeTraitsBase2<FInventoryItemArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
 UCLASS( ClassGroup=(Custom), meta=(BlueprintSpawnableComponent) )
 class SURVIVALGAME_API UInventoryComponent : public UActorComponent
 {
 	GENERATED_BODY()
 
 	friend class UItem;
+	friend struct FInventoryItemEntry;
 
 public:	
 	// Sets default values for this component's properties
@@ -94,18 +237,45 @@ public:
 	UFUNCTION(BlueprintCallable, Category = "Inventory")
 	FItemAddResult TryAddItemFromClass(TSubclassOf<class UItem> ItemClass, const int32 Quantity);
 
+	/** Add a batch of items to the inventory, for example when looting a container or a corpse.
+	Capacity and weight are checked once up front, and replication and OnInventoryUpdated are only flushed once the whole batch is done.
+	@return one result per item, in the same order as ItemsToAdd. */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	TArray<FItemAddResult> TryAddItems(const TArray<UItem*>& ItemsToAdd);
+
 	/** Take some quantity away from the item, and remove it from the inventory when quantity reaches zero. 
 	Useful for actions like eating food, using ammo, etc. */
 
 	int32 ConsumeItem(UItem* Item);
 	int32 ConsumeItem(UItem* Item, const int32 Quantity);
 
+	/** Take some quantity of an item class away, across as many stacks as needed. Works for lightweight stacks that don't have an item instance.
+	@return the amount that was actually taken. */
+	UFUNCTION(BlueprintCallable, Category = Inventory)
+	int32 ConsumeItemsByClass(TSubclassOf<UItem> ItemClass, const int32 Quantity);
+
 	UFUNCTION(BlueprintCallable, Category = Inventory)
 	bool RemoveItem(UItem* Item);
 
+	/** Remove a batch of items, only flushing replication and UI updates once at the end.
+	@return the number of items that were removed. */
+	UFUNCTION(BlueprintCallable, Category = Inventory)
+	int32 RemoveItems(const TArray<UItem*>& ItemsToRemove);
+
+	/** Open a batch. Until the matching EndBatch(), items are only flagged for replication once instead of per change.
+	Batches can be nested, everything is flushed when the outermost one ends. Prefer FInventoryBatchScope over calling these directly. */
+	void BeginBatch();
+	void EndBatch();
+
+	FORCEINLINE bool IsInBatch() const { return BatchDepth > 0; }
+
 	UFUNCTION(BlueprintPure, Category = Inventory)
 	bool HasItem(TSubclassOf<UItem> ItemClass, const int32 Quantity = 1) const;
 
+	// Total quantity of an item class across all of its stacks.
+	UFUNCTION(BlueprintPure, Category = Inventory)
+	int32 GetItemQuantity(TSubclassOf<UItem> ItemClass) const;
+
 	UFUNCTION(BlueprintPure, Category = Inventory)
 	UItem* FindItem(UItem* Item) const;
 
@@ -115,9 +285,24 @@ public:
 	UFUNCTION(BlueprintPure, Category = Inventory)
 	TArray<UItem*> FindItemsByClass(TSubclassOf<UItem> ItemClass) const;
 
+	/** Fill OutItems with the items matching the query. Only instanced items are returned, like GetItems().
+	OutItems is reset but keeps its allocation, so callers that hold on to their array don't allocate per query. */
+	UFUNCTION(BlueprintCallable, Category = Inventory)
+	void QueryItems(const FInventoryQuery& Query, TArray<UItem*>& OutItems) const;
+
+	/** Fill OutSlots with the slots of every stack matching the query, including lightweight stacks.
+	Runs over a flat copy of the item attributes instead of touching every item object. */
+	void QueryItemSlots(const FInventoryQuery& Query, TArray<int32>& OutSlots) const;
+
 	UFUNCTION(BlueprintPure, Category = Inventory)
 	float GetCurrentWeight() const;
 
+	UFUNCTION(BlueprintPure, Category = Inventory)
+	FORCEINLINE int32 GetNumUsedSlots() const { return Items.Num(); }
+
+	// [server] Total bytes ReplicateSubobjects() has written across all channels, for benchmarking.
+	FORCEINLINE int64 GetReplicatedBytes() const { return ReplicatedBytes; }
+
 	UFUNCTION(BLueprintCallable, Category = Inventory)
 	void SetWeightCapacity(const float NewWeightCapacity);
 
@@ -131,14 +316,42 @@ public:
 	FORCEINLINE int32 GetCapacity() const { return Capacity; }
 
 	UFUNCTION(BlueprintPure, Category = "Inventory")
-	FORCEINLINE TArray<class UItem*> GetItems() const { return Items; }
+	TArray<class UItem*> GetItems() const;
+
+	// Copy the item classes, quantities and capacities into a snapshot that can be saved.
+	void CaptureSnapshot(FInventorySnapshot& OutSnapshot) const;
+
+	/** [server] Replace the contents of the inventory with a snapshot. The inventory is rebuilt in one go:
+	items aren't broadcast one by one, the array is replicated once, and OnInventoryUpdated fires once.
+	Stacks whose class no longer exists are dropped. */
+	bool ApplySnapshot(const FInventorySnapshot& Snapshot);
+
+	/** Write the inventory to Saved/Inventories/<SlotName>.inv. Only the snapshot is taken on the game thread,
+	serializing and writing the file happen in the background. */
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void SaveInventory(const FString& SlotName);
 
-	UFUNCTION(Client, Reliable)
-	void ClientRefreshInventory();
+	// [server] Read Saved/Inventories/<SlotName>.inv in the background, then apply it. Keeps the current contents if the file can't be loaded.
+	UFUNCTION(BlueprintCallable, Category = "Inventory")
+	void LoadInventory(const FString& SlotName);
+
+	static FString GetInventorySavePath(const FString& SlotName);
+
+	// What changed in the inventory for the OnInventoryUpdated broadcast that's currently going out.
+	FORCEINLINE EInventoryUpdateFlags GetLastUpdateFlags() const { return LastUpdateFlags; }
 
 	UPROPERTY(BlueprintAssignable, Category = Inventory)
 	FOnInventoryUpdated OnInventoryUpdated;
 
+	UPROPERTY(BlueprintAssignable, Category = Inventory)
+	FOnInventoryItemAdded OnItemAdded;
+
+	UPROPERTY(BlueprintAssignable, Category = Inventory)
+	FOnInventoryItemRemoved OnItemRemoved;
+
+	UPROPERTY(BlueprintAssignable, Category = Inventory)
+	FOnInventoryItemChanged OnItemChanged;
+
 protected:
 
 	// Maximum weight the inventory can hold. For players, backpacks and other items can increase this limit.
@@ -149,23 +362,149 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory", meta = (ClampMin = 0, ClampMax = 200))
 	int32 Capacity /* : 2 */;
 
-	UPROPERTY(ReplicatedUsing = OnRep_Items, VisibleAnywhere, Category = "Inventory")
-	TArray<class UItem*> Items;
+	UPROPERTY(Replicated, VisibleAnywhere, Category = "Inventory")
+	FInventoryItemArray Items;
+
+	/** Store items as lightweight stacks that reference their shared class defaults, instead of creating an item object per stack.
+	 * Only items that require their own instance still get one. Meant for storage containers and NPC stashes,
+	 * since GetItems() and the inventory UI only see instanced items. */
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Inventory")
+	bool bUseLightweightStacks;
 
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags);
 
 private:
-	/** Don't call Items.Add() directly, use this function instead, as it handles replication and ownership. */
-	UItem* AddItem(UItem* Item);
+	/** Don't call Items.Add() directly, use this function instead, as it handles replication and ownership.
+	 * @return the new item instance, or nullptr if the item was added as a lightweight stack. */
+	UItem* AddItem(const UItem* Item, const int32 Quantity);
+
+	// Removes the stack in this slot and everything that references it.
+	void RemoveEntryAt(const int32 Slot);
+
+	// Sets the quantity of the stack in this slot, going through the item instance if it has one.
+	void SetStackQuantity(const int32 Slot, const int32 NewQuantity);
+
+	// [client] Called by the fast array as entries replicate. If we get, lose or change an item, inventory UI will be refreshed.
+	void OnEntryReplicatedAdd(FInventoryItemEntry& Entry);
+	void OnEntryReplicatedChange(FInventoryItemEntry& Entry);
+	void OnEntryReplicatedRemove(FInventoryItemEntry& Entry);
 
-	UFUNCTION()
-	void OnRep_Items();	// if we get or lose an item, inventory UI will be refreshed.
-		
 	// each item have RepKey and inventory have also a repkey to check if items array is changed!
 	UPROPERTY()
 	int32 ReplicatedItemsKey;	// just a number that changes when items need to replicate!
 
-	// Internal, non-BP exposed add item function. Don't call this directly,; use TryAddItem(), or TryAddItemfromClass() instead.
-	FItemAddResult TryAddItem_Internal(UItem* Item);
+	/** Internal, non-BP exposed add item function. Don't call this directly,; use TryAddItem(), or TryAddItemfromClass() instead.
+	 * Item is only used to read the item's properties, so it can be an instance or the class defaults. */
+	FItemAddResult TryAddItem_Internal(const UItem* Item, const int32 AddAmount);
+
+	/** Maps every item class in the inventory to the slots in Items holding an item of exactly that class, in slot order.
+	 * AddItem() and RemoveItem() keep it in sync on the server, clients flag it dirty as entries replicate and rebuild it on the next lookup.
+	 * This way class lookups don't have to scan the whole inventory. */
+	mutable TMap<UClass*, TArray<int32>> ItemClassIndex;
+	mutable bool bItemClassIndexDirty;
+
+	// Rebuilds the class index if replication invalidated it.
+	void EnsureItemClassIndex() const;
+
+	// Returns the slot of this exact item instance, or INDEX_NONE if it isn't in the inventory.
+	int32 FindItemSlot(const UItem* Item) const;
+
+	// Returns the first slot holding a stack of exactly this class, or INDEX_NONE.
+	int32 FindStackSlot(TSubclassOf<UItem> ItemClass) const;
+
+	void AddToClassIndex(UClass* ItemClass, const int32 Slot);
+	void RemoveFromClassIndex(UClass* ItemClass, const int32 Slot);
+	void RebuildItemClassIndex() const;
+
+	/** Running total of every item's stack weight, so GetCurrentWeight() doesn't walk the inventory.
+	 * The server updates it as items are added, removed or change quantity. Clients can't rely on the order
+	 * items and their quantities replicate in, so they just flag it dirty and recalculate on the next query. */
+	mutable float CurrentWeight;
+	mutable bool bCurrentWeightDirty;
+
+	// Called by UItem::SetQuantity() on the server so the running weight total and the item's entry stay correct.
+	void OnItemQuantityChanged(UItem* Item, const int32 OldQuantity);
+	void MarkCurrentWeightDirty();
+
+	// Walks every item and sums up their stack weights. Only used to rebuild or verify the running total.
+	float CalculateCurrentWeight() const;
+
+	/** Flat, per slot copies of the item attributes queries look at, so QueryItemSlots() streams through a few small arrays
+	 * instead of chasing a pointer to every item. Rebuilt lazily on the next query after anything in the inventory changes. */
+	struct FItemAttributeMirror
+	{
+		TArray<UClass*> Classes;
+		TArray<EItemRarity> Rarities;
+		TArray<float> Weights;
+		TArray<int32> Quantities;
+		TArray<bool> Stackable;
+	};
+
+	mutable FItemAttributeMirror ItemAttributes;
+	mutable bool bItemAttributesDirty;
+
+	// Slots buffer reused by QueryItems(), so Blueprint queries don't allocate either.
+	mutable TArray<int32> QuerySlotsScratch;
+
+	void EnsureItemAttributes() const;
+
+	// Checks the cached totals against a full recalculation. Compiled out unless slow guards are enabled.
+	void VerifyCachedTotals() const;
+
+	/** Flag the items for replication. If bArrayChanged, entries were removed and the whole fast array needs to be marked dirty.
+	 * Deferred until the end of the batch if one is open. */
+	void MarkItemsDirtyForReplication(const bool bArrayChanged);
+
+	/** Let the UI know the inventory changed. Changes are collected and OnInventoryUpdated is broadcast once on the next tick,
+	 * so a burst of changes in one frame only rebuilds the UI once. */
+	void NotifyInventoryUpdated(const EInventoryUpdateFlags UpdateFlags);
+
+	// Broadcasts OnInventoryUpdated for everything collected by NotifyInventoryUpdated().
+	void FlushInventoryUpdates();
+
+	EInventoryUpdateFlags PendingUpdateFlags;
+	EInventoryUpdateFlags LastUpdateFlags;
+
+	// How many batches are currently open.
+	int32 BatchDepth;
+
+	// What needs to be flushed when the outermost batch ends.
+	uint8 bBatchNeedsReplication : 1;
+	uint8 bBatchArrayChanged : 1;
+
+	int64 ReplicatedBytes;
+};
+
+/** Opens a batch on an inventory for as long as it's in scope.
+ * 
+ *	{
+ *		FInventoryBatchScope Batch(Inventory);
+ *		for (UItem* Item : Loot) { Inventory->TryAddItem(Item); }
+ *	} // items are flagged for replication once here
+ */
+struct FInventoryBatchScope
+{
+	FInventoryBatchScope(UInventoryComponent* InInventory) : Inventory(InInventory)
+	{
+		if (Inventory)
+		{
+			Inventory->BeginBatch();
+		}
+	}
+
+	~FInventoryBatchScope()
+	{
+		if (Inventory)
+		{
+			Inventory->EndBatch();
+		}
+	}
+
+	// Copies would end the batch twice.
+	FInventoryBatchScope(const FInventoryBatchScope&) = delete;
+	FInventoryBatchScope& operator=(const FInventoryBatchScope&) = delete;
+
+private:
+	UInventoryComponent* Inventory;
 };
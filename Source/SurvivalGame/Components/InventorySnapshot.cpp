@@ -0,0 +1,145 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Components/InventorySnapshot.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/MemoryReader.h"
+#include "Misc/FileHelper.h"
+#include "Async/Async.h"
+
+void FInventorySnapshot::Reset()
+{
+	Version = Latest;
+	Capacity = 0;
+	WeightCapacity = 0.f;
+	ItemClasses.Reset();
+	Stacks.Reset();
+}
+
+bool FInventorySnapshot::Serialize(FArchive& Ar)
+{
+	uint32 FileMagic = Magic;
+	Ar << FileMagic;
+
+	if (FileMagic != Magic)
+	{
+		return false;
+	}
+
+	// Always write the latest version, but remember what we read so older files still load.
+	if (Ar.IsSaving())
+	{
+		Version = Latest;
+	}
+	Ar << Version;
+
+	if (Version < Initial || Version > Latest)
+	{
+		return false;
+	}
+
+	Ar << Capacity;
+	Ar << WeightCapacity;
+
+	int32 NumClasses = ItemClasses.Num();
+	Ar << NumClasses;
+
+	if (Ar.IsLoading())
+	{
+		// Every entry takes at least a byte, so anything bigger than the rest of the data is corrupt
+		if (NumClasses < 0 || NumClasses > Ar.TotalSize() - Ar.Tell())
+		{
+			return false;
+		}
+		ItemClasses.SetNum(NumClasses);
+	}
+
+	for (FSoftClassPath& ItemClass : ItemClasses)
+	{
+		FString ClassPath = ItemClass.ToString();
+		Ar << ClassPath;
+
+		if (Ar.IsLoading())
+		{
+			ItemClass = FSoftClassPath(ClassPath);
+		}
+	}
+
+	int32 NumStacks = Stacks.Num();
+	Ar << NumStacks;
+
+	if (Ar.IsLoading())
+	{
+		if (NumStacks < 0 || NumStacks > Ar.TotalSize() - Ar.Tell())
+		{
+			return false;
+		}
+		Stacks.SetNum(NumStacks);
+	}
+
+	// Most inventories have a handful of classes and small stacks, so packed ints are usually a byte each.
+	for (FStack& Stack : Stacks)
+	{
+		uint32 ClassIndex = Stack.ClassIndex;
+		uint32 Quantity = Stack.Quantity;
+		Ar.SerializeIntPacked(ClassIndex);
+		Ar.SerializeIntPacked(Quantity);
+
+		if (Ar.IsLoading())
+		{
+			if (!ItemClasses.IsValidIndex(ClassIndex))
+			{
+				return false;
+			}
+
+			Stack.ClassIndex = ClassIndex;
+			Stack.Quantity = Quantity;
+		}
+	}
+
+	return !Ar.IsError();
+}
+
+bool FInventorySnapshot::SaveToBytes(TArray<uint8>& OutBytes)
+{
+	FMemoryWriter Writer(OutBytes);
+	return Serialize(Writer);
+}
+
+bool FInventorySnapshot::LoadFromBytes(const TArray<uint8>& Bytes)
+{
+	FMemoryReader Reader(Bytes);
+	return Serialize(Reader);
+}
+
+void FInventorySnapshot::SaveToFileAsync(FInventorySnapshot&& Snapshot, const FString& Filename, TFunction<void(bool bSuccess)> OnComplete)
+{
+	Async(EAsyncExecution::ThreadPool, [Snapshot = MoveTemp(Snapshot), Filename, OnComplete = MoveTemp(OnComplete)]() mutable
+	{
+		TArray<uint8> Bytes;
+		const bool bSuccess = Snapshot.SaveToBytes(Bytes) && FFileHelper::SaveArrayToFile(Bytes, *Filename);
+
+		if (OnComplete)
+		{
+			AsyncTask(ENamedThreads::GameThread, [bSuccess, OnComplete = MoveTemp(OnComplete)]()
+			{
+				OnComplete(bSuccess);
+			});
+		}
+	});
+}
+
+void FInventorySnapshot::LoadFromFileAsync(const FString& Filename, TFunction<void(bool bSuccess, FInventorySnapshot&& Snapshot)> OnComplete)
+{
+	Async(EAsyncExecution::ThreadPool, [Filename, OnComplete = MoveTemp(OnComplete)]() mutable
+	{
+		FInventorySnapshot Snapshot;
+		TArray<uint8> Bytes;
+		const bool bSuccess = FFileHelper::LoadFileToArray(Bytes, *Filename, FILEREAD_Silent) && Snapshot.LoadFromBytes(Bytes);
+
+		AsyncTask(ENamedThreads::GameThread, [bSuccess, Snapshot = MoveTemp(Snapshot), OnComplete = MoveTemp(OnComplete)]() mutable
+		{
+			OnComplete(bSuccess, MoveTemp(Snapshot));
+		});
+	});
+}
@@ -0,0 +1,56 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Compact binary copy of an inventory, for saving it to disk. Stores item classes once in a table,
+ * and each stack as an index into that table plus a quantity, instead of serializing every item object.
+ * Capturing and applying happen on the game thread (see UInventoryComponent), serializing can happen on any thread.
+ */
+struct SURVIVALGAME_API FInventorySnapshot
+{
+	// Bump Latest when the format changes, and keep Serialize() able to read the older versions.
+	enum EVersion : int32
+	{
+		Initial = 1,
+
+		VersionPlusOne,
+		Latest = VersionPlusOne - 1
+	};
+
+	// One stack in the inventory.
+	struct FStack
+	{
+		int32 ClassIndex = 0;
+		int32 Quantity = 0;
+	};
+
+	int32 Version = Latest;
+	int32 Capacity = 0;
+	float WeightCapacity = 0.f;
+
+	// Every item class in the inventory, once.
+	TArray<FSoftClassPath> ItemClasses;
+	TArray<FStack> Stacks;
+
+	void Reset();
+
+	/** Reads or writes the snapshot depending on the archive.
+	 * @return false if the data is corrupt or from a newer version, in which case the snapshot shouldn't be used. */
+	bool Serialize(FArchive& Ar);
+
+	bool SaveToBytes(TArray<uint8>& OutBytes);
+	bool LoadFromBytes(const TArray<uint8>& Bytes);
+
+	// Serializes and writes the snapshot on the thread pool. OnComplete is called back on the game thread.
+	static void SaveToFileAsync(FInventorySnapshot&& Snapshot, const FString& Filename, TFunction<void(bool bSuccess)> OnComplete = nullptr);
+
+	// Reads and parses the file on the thread pool. OnComplete is called back on the game thread with the snapshot if it loaded.
+	static void LoadFromFileAsync(const FString& Filename, TFunction<void(bool bSuccess, FInventorySnapshot&& Snapshot)> OnComplete);
+
+private:
+	// Stops us from reading garbage if a file isn't an inventory snapshot at all.
+	static const uint32 Magic = 0x53564E49; // "INVS"
+};
@@ -4,6 +4,7 @@
 #include "Items/Item.h"
 #include "Components/InventoryComponent.h"
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
 
 #define LOCTEXT_NAMESPACE "Item"
 
@@ -11,7 +12,10 @@ void UItem::GetLifetimeReplicatedProps(TArray<class FLifetimeProperty>& OutLifet
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(UItem, Quantity);
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(UItem, Quantity, Params);
 }
 
 bool UItem::IsSupportedForNetworking() const
@@ -36,7 +40,7 @@ void UItem::PostEditChangeProperty(struct FPropertyChangedEvent& PropertyChanged
 
 UItem::UItem() :
 	ItemDisplayName(LOCTEXT("ItemName", "Item")), UseActionText(LOCTEXT("ItemUseActionText", "Use")), Weight(0.f),
-	bStackable(true), Quantity(1), MaxStackSize(2), RepKey(0)
+	bStackable(true), Quantity(1), MaxStackSize(2), bRequiresInstance(false), RepKey(0)
 {
 
 }
@@ -64,12 +68,33 @@ void UItem::MarkDirtyForReplication()
 	// Mark the array for replication
 	if (OwningInventory)
 	{
-		++OwningInventory->ReplicatedItemsKey;
+		OwningInventory->MarkItemsDirtyForReplication(false);
+	}
+	// Items lying in the world belong to a pickup, which is usually dormant. Wake it so the change actually gets sent.
+	else if (AActor* OuterActor = GetTypedOuter<AActor>())
+	{
+		OuterActor->FlushNetDormancy();
 	}
 }
 
+void UItem::ResetPooledState()
+{
+	const UItem* ItemDefaults = GetClass()->GetDefaultObject<UItem>();
+
+	Quantity = ItemDefaults->Quantity;
+	MARK_PROPERTY_DIRTY_FROM_NAME(UItem, Quantity, this);
+	RepKey = 0;
+	OwningInventory = nullptr;
+	OnItemModified.Clear();
+}
+
 void UItem::OnRep_Quantity()
 {
+	if (OwningInventory)
+	{
+		OwningInventory->MarkCurrentWeightDirty();
+	}
+
 	OnItemModified.Broadcast();
 }
 
@@ -77,8 +102,28 @@ void UItem::SetQuantity(const int32 NewQuantity)
 {
 	if (NewQuantity != Quantity)
 	{
+		const int32 OldQuantity = Quantity;
 		Quantity = FMath::Clamp(NewQuantity, 0, bStackable ? MaxStackSize : 1);
-		MarkDirtyForReplication();
+		MARK_PROPERTY_DIRTY_FROM_NAME(UItem, Quantity, this);
+
+		// Items in an inventory replicate their quantity through the inventory's entry for them, so we don't need to resend the whole item.
+		if (OwningInventory)
+		{
+			OwningInventory->OnItemQuantityChanged(this, OldQuantity);
+		}
+		else
+		{
+			MarkDirtyForReplication();
+		}
+	}
+}
+
+void UItem::ApplyReplicatedQuantity(const int32 NewQuantity)
+{
+	if (NewQuantity != Quantity)
+	{
+		Quantity = NewQuantity;
+		OnRep_Quantity();
 	}
 }
 
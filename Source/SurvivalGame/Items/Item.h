@@ -42,8 +42,10 @@ public:
 	FORCEINLINE FText GetItemDisplayName() const { return ItemDisplayName; }
 	FORCEINLINE float GetWeight() const { return Weight; }
 	FORCEINLINE bool GetIsStackable() const { return bStackable; }
+	FORCEINLINE EItemRarity GetRarity() const { return ItemRarity; }
 	FORCEINLINE int32 GetMaxStackSize() const { return MaxStackSize; }
 	FORCEINLINE class UStaticMesh* GetPickupMesh() const { return PickupMesh; }
+	FORCEINLINE bool RequiresInstance() const { return bRequiresInstance; }
 
 	FORCEINLINE void SetOwningInventory(class UInventoryComponent* InventoryComponent)
 	{
@@ -59,6 +61,9 @@ public:
 	// Marks the object as needing replication. We must call this internally after modifying any replicated properties
 	void MarkDirtyForReplication();
 
+	// Puts the item back into the state of a freshly created one, so the item pool can hand it out again.
+	void ResetPooledState();
+
 protected:
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Item", meta = (AllowPrivateAccess = "true"))
@@ -91,6 +96,10 @@ protected:
 	UPROPERTY(EditDefaultsOnly, BlueprintReadWrite, Category = "Item", meta = (AllowPrivateAccess = "true"))
 	TSubclassOf<class UItemTooltip> ItemTooltip;
 
+	// Whether this item has per-instance state or behavior. If not, inventories using lightweight stacks share the class defaults instead of creating an object for it.
+	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = "Item", meta = (AllowPrivateAccess = "true"))
+	bool bRequiresInstance;
+
 	// Server manages this value
 	UPROPERTY(ReplicatedUsing = OnRep_Quantity, EditAnywhere, Category = "Item", meta = (UIMin = 1, EditCondition = bStackable, AllowPrivateAccess = "true"))
 	int32 Quantity;
@@ -111,6 +120,9 @@ public:
 	UFUNCTION(BlueprintCallable)
 	void SetQuantity(const int32 NewQuantity);
 
+	// [client] Sets the quantity replicated through an inventory entry instead of the item itself.
+	void ApplyReplicatedQuantity(const int32 NewQuantity);
+
 	UFUNCTION(BlueprintPure, Category = "Item")
 	FORCEINLINE int32 GetQuantity() const { return Quantity; }
 
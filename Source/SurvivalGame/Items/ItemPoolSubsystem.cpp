@@ -0,0 +1,125 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Items/ItemPoolSubsystem.h"
+#include "SurvivalGame.h"
+#include "Items/Item.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/PackageMapClient.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Item Pool Hits"), STAT_ItemPoolHits, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Item Pool Misses"), STAT_ItemPoolMisses, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Items"), STAT_PooledItems, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Replicated Items Not Pooled"), STAT_ReplicatedItemsNotPooled, STATGROUP_SurvivalGame);
+
+// Flags used when moving items in and out of the pool. These are runtime objects, so there's nothing to redirect or dirty.
+static const ERenameFlags PooledItemRenameFlags = REN_DontCreateRedirectors | REN_ForceNoResetLoaders | REN_NonTransactional | REN_DoNotDirty;
+
+UItemPoolSubsystem::UItemPoolSubsystem() :
+	MaxPooledItemsPerClass(64), PoolHits(0), PoolMisses(0), NumPooledItems(0)
+{
+
+}
+
+UItem* UItemPoolSubsystem::Acquire(UObject* Outer, TSubclassOf<UItem> ItemClass)
+{
+	UWorld* World = Outer ? Outer->GetWorld() : nullptr;
+
+	if (UItemPoolSubsystem* ItemPool = World ? World->GetSubsystem<UItemPoolSubsystem>() : nullptr)
+	{
+		return ItemPool->AcquireItem(Outer, ItemClass);
+	}
+	return NewObject<UItem>(Outer, ItemClass);
+}
+
+void UItemPoolSubsystem::Release(UItem* Item)
+{
+	UWorld* World = Item ? Item->GetWorld() : nullptr;
+
+	if (UItemPoolSubsystem* ItemPool = World ? World->GetSubsystem<UItemPoolSubsystem>() : nullptr)
+	{
+		ItemPool->ReleaseItem(Item);
+	}
+}
+
+UItem* UItemPoolSubsystem::AcquireItem(UObject* Outer, TSubclassOf<UItem> ItemClass)
+{
+	if (!ItemClass)
+	{
+		return nullptr;
+	}
+
+	if (FItemPool* Pool = Pools.Find(ItemClass))
+	{
+		if (Pool->Items.Num() > 0)
+		{
+			UItem* Item = Pool->Items.Pop(false);
+			Item->Rename(nullptr, Outer, PooledItemRenameFlags);
+
+			++PoolHits;
+			--NumPooledItems;
+			INC_DWORD_STAT(STAT_ItemPoolHits);
+			DEC_DWORD_STAT(STAT_PooledItems);
+
+			return Item;
+		}
+	}
+
+	++PoolMisses;
+	INC_DWORD_STAT(STAT_ItemPoolMisses);
+
+	return NewObject<UItem>(Outer, ItemClass);
+}
+
+bool UItemPoolSubsystem::ReleaseItem(UItem* Item)
+{
+	if (!Item || Item->IsPendingKill())
+	{
+		return false;
+	}
+
+	// Clients and the server's package maps keep the item's net GUID, so a recycled one could resolve to the wrong object. Leave it for the GC.
+	if (IsKnownToNetDriver(Item))
+	{
+		INC_DWORD_STAT(STAT_ReplicatedItemsNotPooled);
+		return false;
+	}
+
+	FItemPool& Pool = Pools.FindOrAdd(Item->GetClass());
+
+	if (Pool.Items.Num() >= MaxPooledItemsPerClass)
+	{
+		return false;
+	}
+
+	Item->ResetPooledState();
+
+	// Hold on to the item ourselves, the actor that owned it may be about to be destroyed.
+	Item->Rename(nullptr, this, PooledItemRenameFlags);
+	Pool.Items.Add(Item);
+
+	++NumPooledItems;
+	INC_DWORD_STAT(STAT_PooledItems);
+
+	return true;
+}
+
+void UItemPoolSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_PooledItems, NumPooledItems);
+
+	Pools.Empty();
+	NumPooledItems = 0;
+
+	Super::Deinitialize();
+}
+
+bool UItemPoolSubsystem::IsKnownToNetDriver(const UItem* Item) const
+{
+	if (UNetDriver* NetDriver = GetWorld()->GetNetDriver())
+	{
+		return NetDriver->GuidCache.IsValid() && NetDriver->GuidCache->GetNetGUID(Item).IsValid();
+	}
+	return false;
+}
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "ItemPoolSubsystem.generated.h"
+
+class UItem;
+
+// All of the pooled items of one class.
+USTRUCT()
+struct FItemPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<UItem*> Items;
+};
+
+/**
+ * Recycles UItem objects so moving items between pickups and inventories doesn't leave a trail of garbage for the GC.
+ * Items that the net driver already knows about are never recycled, as clients would end up with the wrong object for their net GUID.
+ */
+UCLASS(Config = Game)
+class SURVIVALGAME_API UItemPoolSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UItemPoolSubsystem();
+
+	/** Helpers that use the pool of Outer's world, and fall back to creating and dropping items if there isn't one. */
+	static UItem* Acquire(UObject* Outer, TSubclassOf<UItem> ItemClass);
+	static void Release(UItem* Item);
+
+	// Returns a pooled item of this class outered to Outer, or creates a new one if there is none.
+	UItem* AcquireItem(UObject* Outer, TSubclassOf<UItem> ItemClass);
+
+	// Resets the item and puts it back in the pool. Returns false if the item couldn't be pooled and was left for the GC.
+	bool ReleaseItem(UItem* Item);
+
+	virtual void Deinitialize() override;
+
+	FORCEINLINE int32 GetPoolHits() const { return PoolHits; }
+	FORCEINLINE int32 GetPoolMisses() const { return PoolMisses; }
+	FORCEINLINE int32 GetNumPooledItems() const { return NumPooledItems; }
+
+private:
+	// Whether the net driver has assigned the item a net GUID, meaning it has been replicated at some point.
+	bool IsKnownToNetDriver(const UItem* Item) const;
+
+	UPROPERTY()
+	TMap<UClass*, FItemPool> Pools;
+
+	// How many items of one class we keep around at most.
+	UPROPERTY(Config)
+	int32 MaxPooledItemsPerClass;
+
+	int32 PoolHits;
+	int32 PoolMisses;
+	int32 NumPooledItems;
+};
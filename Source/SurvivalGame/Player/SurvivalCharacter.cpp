@@ -9,10 +9,23 @@
 #include "Components/CapsuleComponent.h"
 #include "Items/Item.h"
 #include "../World/Pickup.h"
+#include "World/InteractionSubsystem.h"
+#include "World/InteractionSchedulerSubsystem.h"
+#include "World/WorldItemSubsystem.h"
+#include "World/WorldItemChunk.h"
+#include "World/PickupSubsystem.h"
+#include "SurvivalGame.h"
+#include "GameFramework/GameStateBase.h"
+
+DECLARE_DWORD_COUNTER_STAT(TEXT("Interaction Checks"), STAT_InteractionChecks, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Skipped Interaction Checks"), STAT_SkippedInteractionChecks, STATGROUP_SurvivalGame);
 
 // Sets default values
 ASurvivalCharacter::ASurvivalCharacter() :
-	InteractionCheckFrequency(0.f), InteractionCheckDistance(1000.f)
+	bDropAsWorldItems(true), PromoteRequestRetryDelay(1.f), InteractionCheckFrequency(0.f), InteractionCheckDistance(1000.f), InteractionCheckMode(EInteractionCheckMode::ICM_ASYNCTRACE),
+	InteractionConeHalfAngle(10.f), bSkipUnchangedInteractionChecks(true), InteractionCheckMinViewMove(1.f), InteractionCheckMinViewRotation(0.5f),
+	InteractionCheckMaxSkipTime(0.5f), NumInteractionChecks(0), NumSkippedInteractionChecks(0), ViewHistorySize(32), MaxInteractionRewindTime(0.5f),
+	ViewHistoryNext(0), PendingInteractTimeStamp(-1.f), LastPromoteRequestRecordId(INDEX_NONE), LastPromoteRequestTime(0.f)
 {
  	// Set this character to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = true;
@@ -58,6 +71,8 @@ ASurvivalCharacter::ASurvivalCharacter() :
 	PlayerInventory = CreateDefaultSubobject<UInventoryComponent>(FName(TEXT("Inventory")));
 	PlayerInventory->SetCapacity(20);
 	PlayerInventory->SetWeightCapacity(60.f);
+
+	InteractionTraceDelegate.BindUObject(this, &ASurvivalCharacter::OnInteractionTraceCompleted);
 }
 
 // Called when the game starts or when spawned
@@ -67,14 +82,31 @@ void ASurvivalCharacter::BeginPlay()
 	
 }
 
+void ASurvivalCharacter::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (HasAuthority())
+	{
+		SetReportedFocus(nullptr);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
 // Called every frame
 void ASurvivalCharacter::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
 
-	const bool bIsInteractingOnServer = (HasAuthority() && IsInteracting());
-
-	if ((!HasAuthority() || bIsInteractingOnServer) && GetWorld()->TimeSince(InteractionData.LastInteractionCheckTime) > InteractionCheckFrequency)
+	/** The server doesn't look for interactables every tick. It checks once against the rewound view when an interact begins,
+	 * and once more when a timed interact completes, so all it needs to do per tick is remember where remote players are looking. */
+	if (HasAuthority())
+	{
+		if (!IsLocallyControlled())
+		{
+			RecordViewSample();
+		}
+	}
+	else if (GetWorld()->TimeSince(InteractionData.LastInteractionCheckTime) > InteractionCheckFrequency)
 		PerformInteractionCheck();
 }
 
@@ -143,49 +175,295 @@ void ASurvivalCharacter::PerformInteractionCheck()
 
 	GetController()->GetPlayerViewPoint(EyesLocation, EyesRotation);
 
+	if (ShouldSkipInteractionCheck(EyesLocation, EyesRotation))
+	{
+		return;
+	}
+
+	// Cleared first, so a recheck forced by what this check finds isn't lost
+	const bool bForcedCheck = InteractionData.bForceInteractionCheck;
+	InteractionData.bForceInteractionCheck = false;
+
+	if (PerformInteractionCheckFrom(EyesLocation, EyesRotation))
+	{
+		RecordInteractionCheck(EyesLocation, EyesRotation);
+	}
+	else
+	{
+		// An async trace is still in flight so nothing was checked, leave the last view and any forced recheck for next time
+		InteractionData.bForceInteractionCheck |= bForcedCheck;
+	}
+}
+
+bool ASurvivalCharacter::PerformInteractionCheckFrom(const FVector& EyesLocation, const FRotator& EyesRotation)
+{
 	FVector TraceStart = EyesLocation;
 	FVector TraceEnd = EyesRotation.Vector() * InteractionCheckDistance + TraceStart;
 	FHitResult TraceHit;
 
+	// Synchronous but doesn't touch physics unless it finds something, so the server can use it too
+	if (InteractionCheckMode == EInteractionCheckMode::ICM_SPATIALQUERY)
+	{
+		PerformSpatialInteractionCheck(EyesLocation, EyesRotation.Vector());
+		return true;
+	}
+
 	FCollisionQueryParams QueryParams;
 	QueryParams.AddIgnoredActor(this);
 
-	if (GetWorld()->LineTraceSingleByChannel(TraceHit, TraceStart, TraceEnd, ECollisionChannel::ECC_Visibility, QueryParams))
+	if (InteractionCheckMode == EInteractionCheckMode::ICM_ASYNCTRACE && !HasAuthority())
 	{
-		if (TraceHit.GetActor())
+		// Still waiting on the last one, no point stacking up traces that will be stale by the time they come back
+		if (InteractionTraceHandle.IsValid() && GetWorld()->IsTraceHandleValid(InteractionTraceHandle, false))
 		{
-			if (UInteractionComponent* InteractionComponent = Cast<UInteractionComponent>(TraceHit.GetActor()->GetComponentByClass(UInteractionComponent::StaticClass())))
-			{
-				float distance = (TraceStart - TraceHit.ImpactPoint).Size();
+			return false;
+		}
 
-				if (InteractionComponent != GetInteractable() && distance <= InteractionComponent->GetInteractionDistance())
-				{
-					FoundNewInteractable(InteractionComponent);
-				}
-				else if (distance > InteractionComponent->GetInteractionDistance() && GetInteractable())
-				{
-					CouldntFindInteractable();
-				}
+		InteractionTraceHandle = GetWorld()->AsyncLineTraceByChannel(EAsyncTraceType::Single, TraceStart, TraceEnd, ECollisionChannel::ECC_Visibility,
+			QueryParams, FCollisionResponseParams::DefaultResponseParam, &InteractionTraceDelegate);
+		return true;
+	}
 
-				return;
+	const bool bHit = GetWorld()->LineTraceSingleByChannel(TraceHit, TraceStart, TraceEnd, ECollisionChannel::ECC_Visibility, QueryParams);
+	ProcessInteractionHit(bHit, TraceHit, TraceStart);
+	return true;
+}
+
+bool ASurvivalCharacter::ShouldSkipInteractionCheck(const FVector& EyesLocation, const FRotator& EyesRotation)
+{
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	if (bSkipUnchangedInteractionChecks && !InteractionData.bForceInteractionCheck
+		&& TimeSeconds - InteractionData.LastPerformedCheckTime <= InteractionCheckMaxSkipTime
+		&& FVector::DistSquared(EyesLocation, InteractionData.LastCheckViewLocation) <= FMath::Square(InteractionCheckMinViewMove)
+		&& EyesRotation.Equals(InteractionData.LastCheckViewRotation, InteractionCheckMinViewRotation))
+	{
+		++NumSkippedInteractionChecks;
+		INC_DWORD_STAT(STAT_SkippedInteractionChecks);
+		return true;
+	}
+	return false;
+}
+
+void ASurvivalCharacter::RecordInteractionCheck(const FVector& EyesLocation, const FRotator& EyesRotation)
+{
+	InteractionData.LastPerformedCheckTime = GetWorld()->GetTimeSeconds();
+	InteractionData.LastCheckViewLocation = EyesLocation;
+	InteractionData.LastCheckViewRotation = EyesRotation;
+
+	++NumInteractionChecks;
+	INC_DWORD_STAT(STAT_InteractionChecks);
+}
+
+void ASurvivalCharacter::RecordViewSample()
+{
+	if (!GetController())
+	{
+		return;
+	}
+
+	FInteractionViewSample Sample;
+	Sample.TimeSeconds = GetWorld()->GetTimeSeconds();
+	GetController()->GetPlayerViewPoint(Sample.Location, Sample.Rotation);
+
+	if (ViewHistory.Num() < ViewHistorySize)
+	{
+		ViewHistory.Add(Sample);
+		ViewHistoryNext = ViewHistory.Num() % ViewHistorySize;
+	}
+	else
+	{
+		ViewHistory[ViewHistoryNext] = Sample;
+		ViewHistoryNext = (ViewHistoryNext + 1) % ViewHistorySize;
+	}
+}
+
+bool ASurvivalCharacter::GetRewoundViewPoint(const float TimeStamp, FVector& OutLocation, FRotator& OutRotation) const
+{
+	const int32 NumSamples = ViewHistory.Num();
+	if (NumSamples == 0)
+	{
+		return false;
+	}
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+	const float TargetTime = FMath::Clamp(TimeStamp, TimeSeconds - MaxInteractionRewindTime, TimeSeconds);
+
+	// Walk back from the newest sample until we pass the target time, then blend between the two samples either side of it
+	const FInteractionViewSample* NewerSample = nullptr;
+	for (int32 i = 0; i < NumSamples; ++i)
+	{
+		const FInteractionViewSample& Sample = ViewHistory[(ViewHistoryNext - 1 - i + NumSamples) % NumSamples];
+
+		if (Sample.TimeSeconds <= TargetTime)
+		{
+			if (NewerSample && NewerSample->TimeSeconds > Sample.TimeSeconds)
+			{
+				const float Alpha = (TargetTime - Sample.TimeSeconds) / (NewerSample->TimeSeconds - Sample.TimeSeconds);
+				OutLocation = FMath::Lerp(Sample.Location, NewerSample->Location, Alpha);
+				OutRotation = FQuat::Slerp(Sample.Rotation.Quaternion(), NewerSample->Rotation.Quaternion(), Alpha).Rotator();
 			}
 			else
 			{
-				CouldntFindInteractable();
+				OutLocation = Sample.Location;
+				OutRotation = Sample.Rotation;
 			}
+			return true;
 		}
+
+		NewerSample = &Sample;
 	}
+
+	// Older than anything we have, so the oldest sample is the best we can do
+	OutLocation = NewerSample->Location;
+	OutRotation = NewerSample->Rotation;
+	return true;
 }
 
-void ASurvivalCharacter::CouldntFindInteractable()
+void ASurvivalCharacter::OnFocusedInteractableChanged(UInteractionComponent* Interactable)
+{
+	InteractionData.bForceInteractionCheck = true;
+}
+
+float ASurvivalCharacter::GetInteractionCheckSkipRatio() const
+{
+	const int32 TotalChecks = NumInteractionChecks + NumSkippedInteractionChecks;
+	return TotalChecks > 0 ? (float)NumSkippedInteractionChecks / TotalChecks : 0.f;
+}
+
+void ASurvivalCharacter::PerformSpatialInteractionCheck(const FVector& EyesLocation, const FVector& ViewDirection)
+{
+	UInteractionSubsystem* InteractionSubsystem = GetWorld()->GetSubsystem<UInteractionSubsystem>();
+	if (!InteractionSubsystem)
+	{
+		return;
+	}
+
+	InteractionSubsystem->FindInteractablesInCone(EyesLocation, ViewDirection, InteractionCheckDistance, InteractionConeHalfAngle, InteractionCandidates);
+
+	UInteractionComponent* BestInteractable = InteractionCandidates.Num() > 0 ? InteractionCandidates[0] : nullptr;
+
+	// Only the best candidate gets a trace. If something is in the way we just don't focus anything, rather than trying the rest.
+	if (BestInteractable)
+	{
+		FCollisionQueryParams QueryParams;
+		QueryParams.AddIgnoredActor(this);
+
+		FHitResult TraceHit;
+		if (GetWorld()->LineTraceSingleByChannel(TraceHit, EyesLocation, BestInteractable->GetComponentLocation(), ECollisionChannel::ECC_Visibility, QueryParams)
+			&& TraceHit.GetActor() != BestInteractable->GetOwner())
+		{
+			BestInteractable = nullptr;
+		}
+	}
+
+	// World items aren't in the interaction subsystem until they're promoted, so trace for them instead if there are any around
+	if (!BestInteractable)
+	{
+		UWorldItemSubsystem* WorldItems = GetWorld()->GetSubsystem<UWorldItemSubsystem>();
+		if (WorldItems && WorldItems->HasChunkNear(EyesLocation, InteractionCheckDistance))
+		{
+			FCollisionQueryParams QueryParams;
+			QueryParams.AddIgnoredActor(this);
+
+			FHitResult TraceHit;
+			if (GetWorld()->LineTraceSingleByChannel(TraceHit, EyesLocation, EyesLocation + ViewDirection * InteractionCheckDistance, ECollisionChannel::ECC_Visibility, QueryParams)
+				&& Cast<AWorldItemChunk>(TraceHit.GetActor()))
+			{
+				ProcessInteractionHit(true, TraceHit, EyesLocation);
+				return;
+			}
+		}
+	}
+
+	if (BestInteractable)
+	{
+		if (BestInteractable != GetInteractable())
+		{
+			FoundNewInteractable(BestInteractable);
+		}
+	}
+	else if (GetInteractable())
+	{
+		CouldntFindInteractable();
+	}
+}
+
+void ASurvivalCharacter::OnInteractionTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum)
 {
-	if (GetWorldTimerManager().IsTimerActive(TimerHandle_Interact))
+	InteractionTraceHandle = FTraceHandle();
+
+	// The controller may have gone away while the trace was in flight
+	if (!GetController())
+	{
+		return;
+	}
+
+	const bool bHit = TraceDatum.OutHits.Num() > 0 && TraceDatum.OutHits[0].bBlockingHit;
+	ProcessInteractionHit(bHit, bHit ? TraceDatum.OutHits[0] : FHitResult(), TraceDatum.Start);
+}
+
+void ASurvivalCharacter::ProcessInteractionHit(const bool bHit, const FHitResult& TraceHit, const FVector& TraceStart)
+{
+	// Looking away from world items, so if the server turned a request down we can ask for the same item again when we look back
+	if (!bHit || !Cast<AWorldItemChunk>(TraceHit.GetActor()))
+	{
+		LastPromoteRequestChunk.Reset();
+		LastPromoteRequestRecordId = INDEX_NONE;
+	}
+
+	// Looking at nothing at all means we aren't looking at the interactable anymore either. The server relies on this to fail validation.
+	if (!bHit || !TraceHit.GetActor())
+	{
+		if (GetInteractable())
+		{
+			CouldntFindInteractable();
+		}
+		return;
+	}
+
+	// World items have no interaction component until the server promotes them to a pickup
+	if (AWorldItemChunk* Chunk = Cast<AWorldItemChunk>(TraceHit.GetActor()))
 	{
-		GetWorldTimerManager().ClearTimer(TimerHandle_Interact);
+		if (GetInteractable())
+		{
+			CouldntFindInteractable();
+		}
+
+		const int32 RecordId = Chunk->GetRecordIdForInstance(TraceHit.GetComponent(), TraceHit.Item);
+		if (RecordId != INDEX_NONE && IsLocallyControlled() && (TraceStart - TraceHit.ImpactPoint).Size() <= InteractionCheckDistance)
+		{
+			RequestPromoteWorldItem(Chunk, RecordId);
+		}
+		return;
 	}
 
+	if (UInteractionComponent* InteractionComponent = Cast<UInteractionComponent>(TraceHit.GetActor()->GetComponentByClass(UInteractionComponent::StaticClass())))
+	{
+		float distance = (TraceStart - TraceHit.ImpactPoint).Size();
+
+		if (InteractionComponent != GetInteractable() && distance <= InteractionComponent->GetInteractionDistance())
+		{
+			FoundNewInteractable(InteractionComponent);
+		}
+		else if (distance > InteractionComponent->GetInteractionDistance() && GetInteractable())
+		{
+			CouldntFindInteractable();
+		}
+	}
+	else
+	{
+		CouldntFindInteractable();
+	}
+}
+
+void ASurvivalCharacter::CouldntFindInteractable()
+{
+	CancelTimedInteraction();
+
 	if (UInteractionComponent* Interactable = GetInteractable())
 	{
+		Interactable->OnInteractableChanged.RemoveAll(this);
 		Interactable->EndFocus(this);
 
 		if (InteractionData.bInteractHeld)
@@ -194,6 +472,8 @@ void ASurvivalCharacter::CouldntFindInteractable()
 		}
 	}
 	InteractionData.ViewedInteractionComponent = nullptr;
+
+	ReportFocus(nullptr);
 }
 
 void ASurvivalCharacter::FoundNewInteractable(UInteractionComponent* Interactable)
@@ -202,24 +482,81 @@ void ASurvivalCharacter::FoundNewInteractable(UInteractionComponent* Interactabl
 
 	if (UInteractionComponent* oldInteractable = GetInteractable())
 	{
+		oldInteractable->OnInteractableChanged.RemoveAll(this);
 		oldInteractable->EndFocus(this);
 	}
 	InteractionData.ViewedInteractionComponent = Interactable;
+	Interactable->OnInteractableChanged.AddUObject(this, &ASurvivalCharacter::OnFocusedInteractableChanged);
 	Interactable->BeginFocus(this);
+
+	ReportFocus(Interactable);
+}
+
+void ASurvivalCharacter::ReportFocus(UInteractionComponent* Interactable)
+{
+	if (!IsLocallyControlled() || ReportedFocus.Get() == Interactable)
+	{
+		return;
+	}
+
+	if (HasAuthority())
+	{
+		SetReportedFocus(Interactable);
+	}
+	else
+	{
+		ReportedFocus = Interactable;
+		ServerSetFocusedInteractable(Interactable);
+	}
+}
+
+void ASurvivalCharacter::SetReportedFocus(UInteractionComponent* Interactable)
+{
+	UInteractionComponent* OldFocus = ReportedFocus.Get();
+	if (OldFocus == Interactable)
+	{
+		return;
+	}
+
+	if (OldFocus)
+	{
+		OldFocus->RemoveFocuser(this);
+	}
+
+	ReportedFocus = Interactable;
+
+	if (Interactable)
+	{
+		Interactable->AddFocuser(this);
+	}
 }
 
 void ASurvivalCharacter::BeginInteract()
 {
 	if (!HasAuthority())
-		ServerBeginInteract();
+	{
+		const AGameStateBase* GameState = GetWorld()->GetGameState();
+		ServerBeginInteract(GameState ? GameState->GetServerWorldTimeSeconds() : GetWorld()->GetTimeSeconds());
+	}
 
 	/** As an optimization, server only checks that we're looking at an item once we begin interacting with it. 
-	 * This saves the server doing a check every tick for an interactable Item. The exception is a non-instant
-	 * interact. In this case, the server will check every tick for the duration of the interact. 
+	 * This saves the server doing a check every tick for an interactable Item. The check is done against where the client
+	 * was looking when they pressed the key, so latency doesn't make it fail. Non-instant interacts are checked again when they complete.
 	 **/
 	if (HasAuthority())
 	{
-		PerformInteractionCheck();
+		InteractionData.bForceInteractionCheck = true;
+
+		FVector EyesLocation;
+		FRotator EyesRotation;
+		if (PendingInteractTimeStamp >= 0.f && GetRewoundViewPoint(PendingInteractTimeStamp, EyesLocation, EyesRotation))
+		{
+			PerformInteractionCheckFrom(EyesLocation, EyesRotation);
+		}
+		else
+		{
+			PerformInteractionCheck();
+		}
 	}
 
 	InteractionData.bInteractHeld = true;
@@ -234,7 +571,10 @@ void ASurvivalCharacter::BeginInteract()
 		}
 		else
 		{
-			GetWorldTimerManager().SetTimer(TimerHandle_Interact, this, &ASurvivalCharacter::Interact, interactable->GetInteractionTime(), false);
+			if (UInteractionSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UInteractionSchedulerSubsystem>())
+			{
+				InteractionData.InteractEndTime = Scheduler->ScheduleInteraction(this, interactable, interactable->GetInteractionTime());
+			}
 		}
 	}
 }
@@ -246,7 +586,7 @@ void ASurvivalCharacter::EndInteract()
 
 	InteractionData.bInteractHeld = false;
 
-	GetWorldTimerManager().ClearTimer(TimerHandle_Interact);
+	CancelTimedInteraction();
 
 	if (UInteractionComponent* interactable = GetInteractable())
 	{
@@ -256,29 +596,57 @@ void ASurvivalCharacter::EndInteract()
 
 void ASurvivalCharacter::Interact()
 {
-	GetWorldTimerManager().ClearTimer(TimerHandle_Interact);
+	CancelTimedInteraction();
 	if (UInteractionComponent* Interactable = GetInteractable())
 	{
 		Interactable->Interact(this);		
 	}
 }
 
+bool ASurvivalCharacter::ValidateTimedInteraction(UInteractionComponent* Interactable)
+{
+	// A timed interact was validated when it began, make sure the player is still looking at the thing now that it's done
+	if (HasAuthority())
+	{
+		InteractionData.bForceInteractionCheck = true;
+		PerformInteractionCheck();
+	}
+
+	return Interactable && GetInteractable() == Interactable;
+}
+
+void ASurvivalCharacter::CancelTimedInteraction()
+{
+	if (InteractionData.InteractEndTime > 0.f)
+	{
+		InteractionData.InteractEndTime = 0.f;
+
+		if (UInteractionSchedulerSubsystem* Scheduler = GetWorld()->GetSubsystem<UInteractionSchedulerSubsystem>())
+		{
+			Scheduler->CancelInteraction(this);
+		}
+	}
+}
+
 bool ASurvivalCharacter::IsInteracting() const
 {
-	return GetWorldTimerManager().IsTimerActive(TimerHandle_Interact);
+	return InteractionData.InteractEndTime > 0.f;
 }
 
 float ASurvivalCharacter::GetRemainingInteractTime() const
 {
-	return GetWorldTimerManager().GetTimerRemaining(TimerHandle_Interact);
+	// Same as the timer manager would give us for a timer that isn't running
+	return IsInteracting() ? FMath::Max(InteractionData.InteractEndTime - GetWorld()->GetTimeSeconds(), 0.f) : -1.f;
 }
 
-void ASurvivalCharacter::ServerBeginInteract_Implementation()
+void ASurvivalCharacter::ServerBeginInteract_Implementation(const float ClientTimeStamp)
 {
+	PendingInteractTimeStamp = ClientTimeStamp;
 	BeginInteract();
+	PendingInteractTimeStamp = -1.f;
 }
 
-bool ASurvivalCharacter::ServerBeginInteract_Validate()
+bool ASurvivalCharacter::ServerBeginInteract_Validate(const float ClientTimeStamp)
 {
 	return true;
 }
@@ -339,20 +707,26 @@ void ASurvivalCharacter::DropItem(UItem* Item, const int32 Quantity)
 			const int32 ItemQuantity = Item->GetQuantity();
 			const int32 DroppedQuantity = PlayerInventory->ConsumeItem(Item, Quantity);
 
-			FActorSpawnParameters SpawnParams;
-			SpawnParams.Owner = this;
-			SpawnParams.bNoFail = true;
-			SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
-
 			FVector SpawnLocation = GetActorLocation();
 			SpawnLocation.Z -= GetCapsuleComponent()->GetScaledCapsuleHalfHeight();
 			
 			FTransform SpawnTransform(GetActorRotation(), SpawnLocation);
-			
+
+			if (bDropAsWorldItems && DroppedQuantity > 0)
+			{
+				UWorldItemSubsystem* WorldItems = GetWorld()->GetSubsystem<UWorldItemSubsystem>();
+				if (WorldItems && WorldItems->AddWorldItem(Item->GetClass(), DroppedQuantity, SpawnTransform))
+				{
+					return;
+				}
+			}
+
 			ensure(PickupClass);
-			
-			APickup* Pickup = GetWorld()->SpawnActor<APickup>(PickupClass, SpawnTransform, SpawnParams);
-			Pickup->InitializePickup(Item->GetClass(), DroppedQuantity);
+
+			if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
+			{
+				PickupSubsystem->SpawnPickup(PickupClass, SpawnTransform, Item->GetClass(), DroppedQuantity, this);
+			}
 		}
 	}
 }
@@ -367,4 +741,67 @@ bool ASurvivalCharacter::ServerDropItem_Validate(UItem* Item, const int32 Quanti
 	return true;
 }
 
+void ASurvivalCharacter::RequestPromoteWorldItem(AWorldItemChunk* Chunk, const int32 RecordId)
+{
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+	if (LastPromoteRequestChunk.Get() == Chunk && LastPromoteRequestRecordId == RecordId && TimeSeconds - LastPromoteRequestTime < PromoteRequestRetryDelay)
+	{
+		return;
+	}
+
+	LastPromoteRequestChunk = Chunk;
+	LastPromoteRequestRecordId = RecordId;
+	LastPromoteRequestTime = TimeSeconds;
+
+	ServerPromoteWorldItem(Chunk, RecordId);
+}
+
+void ASurvivalCharacter::ServerPromoteWorldItem_Implementation(AWorldItemChunk* Chunk, const int32 RecordId)
+{
+	if (!Chunk)
+	{
+		return;
+	}
+
+	// The record may already be gone if someone else promoted it first, that's fine
+	const FWorldItemRecord* Record = Chunk->FindRecord(RecordId);
+	if (!Record)
+	{
+		return;
+	}
+
+	// Players can only promote what they could actually be looking at. Give them a bit of slack for movement since they traced.
+	if (FVector::Dist(GetPawnViewLocation(), Record->Location) > InteractionCheckDistance * 1.5f)
+	{
+		return;
+	}
+
+	if (UWorldItemSubsystem* WorldItems = GetWorld()->GetSubsystem<UWorldItemSubsystem>())
+	{
+		ensure(PickupClass);
+		WorldItems->PromoteToPickup(Chunk, RecordId, PickupClass);
+	}
+}
+
+bool ASurvivalCharacter::ServerPromoteWorldItem_Validate(AWorldItemChunk* Chunk, const int32 RecordId)
+{
+	return true;
+}
+
+void ASurvivalCharacter::ServerSetFocusedInteractable_Implementation(UInteractionComponent* Interactable)
+{
+	// Focus only holds off merging and cleanup, but still don't let a client claim things it can't be near
+	if (Interactable && FVector::Dist(GetPawnViewLocation(), Interactable->GetComponentLocation()) > InteractionCheckDistance * 1.5f)
+	{
+		Interactable = nullptr;
+	}
+
+	SetReportedFocus(Interactable);
+}
+
+bool ASurvivalCharacter::ServerSetFocusedInteractable_Validate(UInteractionComponent* Interactable)
+{
+	return true;
+}
+
 // 21. 
\ No newline at end of file
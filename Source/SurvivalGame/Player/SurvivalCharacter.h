@@ -4,11 +4,23 @@
 
 #include "CoreMinimal.h"
 #include "GameFramework/Character.h"
+#include "WorldCollision.h"
 #include "SurvivalCharacter.generated.h"
 
 class UInteractionComponent;
 class UInventoryComponent;
 
+UENUM()
+enum class EInteractionCheckMode : uint8
+{
+	// Trace on the game thread as part of the check. Results are up to date, but every check stalls the game thread on the physics scene.
+	ICM_TRACE			UMETA(DisplayName = "Trace"),
+	// Queue the trace with the async trace API and handle the result next frame. Focus lags a frame behind, which nobody will notice.
+	ICM_ASYNCTRACE		UMETA(DisplayName = "Async Trace"),
+	// Ask the interaction subsystem for interactables in the view cone, and only trace to the best one to check line of sight.
+	ICM_SPATIALQUERY	UMETA(DisplayName = "Spatial Query")
+};
+
 USTRUCT()
 struct FInteractionData
 {
@@ -19,6 +31,11 @@ struct FInteractionData
 		ViewedInteractionComponent = nullptr;
 		LastInteractionCheckTime = 0.f;
 		bInteractHeld = false;
+		LastPerformedCheckTime = 0.f;
+		LastCheckViewLocation = FVector::ZeroVector;
+		LastCheckViewRotation = FRotator::ZeroRotator;
+		bForceInteractionCheck = true;
+		InteractEndTime = 0.f;
 	}
 
 	UPROPERTY()
@@ -30,6 +47,25 @@ struct FInteractionData
 	// whether local player is holding the interact key
 	UPROPERTY()
 	bool bInteractHeld;
+
+	// When we last actually looked for an interactable rather than skipping the check, and where we were looking from.
+	float LastPerformedCheckTime;
+	FVector LastCheckViewLocation;
+	FRotator LastCheckViewRotation;
+
+	// Set when the view hasn't moved but something else might have changed what we're looking at.
+	bool bForceInteractionCheck;
+
+	// World time the timed interact in progress completes at, 0 if there is none. The interaction scheduler owns the actual countdown.
+	float InteractEndTime;
+};
+
+// Where a player was looking at some point in time. The server keeps a short history of these to validate interactions against.
+struct FInteractionViewSample
+{
+	float TimeSeconds;
+	FVector Location;
+	FRotator Rotation;
 };
 
 UCLASS()
@@ -44,6 +80,7 @@ public:
 	
 protected:
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 
 public:	
 	virtual void Tick(float DeltaTime) override;
@@ -54,14 +91,49 @@ public:
 	/* Interactable helper Functions */
 	void PerformInteractionCheck();
 
+	/** The actual check, from a given view point. PerformInteractionCheck() uses the current view, the server can also pass in a rewound one.
+	@return false if nothing was checked, because the last async trace hasn't come back yet. */
+	bool PerformInteractionCheckFrom(const FVector& EyesLocation, const FRotator& EyesRotation);
+
+	// Updates the focused interactable from the result of an interaction trace. bHit is whether the trace hit anything at all.
+	void ProcessInteractionHit(const bool bHit, const FHitResult& TraceHit, const FVector& TraceStart);
+
+	// Whether the view has barely moved since the last check, so the check can be skipped.
+	bool ShouldSkipInteractionCheck(const FVector& EyesLocation, const FRotator& EyesRotation);
+
+	// Remember the view a check went out with, so later ones can be skipped against it. Only called once a check has actually happened.
+	void RecordInteractionCheck(const FVector& EyesLocation, const FRotator& EyesRotation);
+
+	// Bound to the focused interactable, to recheck when it moves, deactivates or goes away.
+	void OnFocusedInteractableChanged(UInteractionComponent* Interactable);
+
+	// [server] Remember where a remote player is looking right now.
+	void RecordViewSample();
+
+	/** [server] Where the player was looking at TimeStamp, interpolated from the view history. Can't go back further than MaxInteractionRewindTime.
+	@return false if there is no history yet. */
+	bool GetRewoundViewPoint(const float TimeStamp, FVector& OutLocation, FRotator& OutRotation) const;
+
+	// Fraction of interaction checks that were skipped because the view didn't move.
+	UFUNCTION(BlueprintPure, Category = "Interaction")
+	float GetInteractionCheckSkipRatio() const;
+
+	// Picks the interactable closest to the view direction out of the interaction subsystem, then checks we can actually see it.
+	// Falls back to a trace when there is nothing to pick but world item chunks are nearby.
+	void PerformSpatialInteractionCheck(const FVector& EyesLocation, const FVector& ViewDirection);
+
+	// Called by the physics scene the frame after an async interaction trace was queued.
+	void OnInteractionTraceCompleted(const FTraceHandle& TraceHandle, FTraceDatum& TraceDatum);
+
 	void CouldntFindInteractable();
 	void FoundNewInteractable(UInteractionComponent* Interactable);
 
 	void BeginInteract();
 	void EndInteract();
 
+	// ClientTimeStamp is the server world time on the client when they pressed interact, so the server can check against where they were looking then.
 	UFUNCTION(Server, Reliable, WithValidation)
-	void ServerBeginInteract();
+	void ServerBeginInteract(const float ClientTimeStamp);
 
 	UFUNCTION(Server, Reliable, WithValidation)
 	void ServerEndInteract();
@@ -78,7 +150,20 @@ public:
 	UFUNCTION(Server, Reliable, WithValidation)
 	void ServerDropItem(UItem* Item, const int32 Quantity);
 
+	// Ask the server to turn a world item we're looking at into a real pickup, so it can be focused and interacted with like any other.
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerPromoteWorldItem(class AWorldItemChunk* Chunk, const int32 RecordId);
+
+	// Tell the server what we're focusing, so it doesn't merge, pool or clean it up from under us. Only sent when focus changes.
+	UFUNCTION(Server, Reliable, WithValidation)
+	void ServerSetFocusedInteractable(UInteractionComponent* Interactable);
+
 	void Interact();
+
+	/** Called by the interaction scheduler when a timed interact finishes, before it completes them.
+	 * The server makes sure the player is still looking at the interactable, clients just finish what they started. */
+	bool ValidateTimedInteraction(UInteractionComponent* Interactable);
+
 	bool IsInteracting() const;
 	float GetRemainingInteractTime() const;
 
@@ -128,6 +213,14 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = Item, meta = (AllowPrivateAccess = true))
 	TSubclassOf<class APickup> PickupClass;
 
+	// Drop items into the world item subsystem instead of spawning a pickup actor for each. They get promoted to pickups when looked at.
+	UPROPERTY(EditDefaultsOnly, Category = Item, meta = (AllowPrivateAccess = true))
+	bool bDropAsWorldItems;
+
+	// Ask again for a world item we're still looking at after this many seconds, in case the server turned the last request down.
+	UPROPERTY(EditDefaultsOnly, Category = Item, meta = (ClampMin = 0.0, AllowPrivateAccess = true))
+	float PromoteRequestRetryDelay;
+
 	// How often in seconds to check an interactable object. Set this to zero if you want to check every tick.
 	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
 	float InteractionCheckFrequency;
@@ -135,7 +228,73 @@ private:
 	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
 	float InteractionCheckDistance;
 
-	FTimerHandle TimerHandle_Interact;
+	/** How clients look for interactables. The server always traces synchronously, as it only checks when an interaction begins
+	 * or is in progress, and needs the answer right away. */
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
+	EInteractionCheckMode InteractionCheckMode;
+
+	// How far off the view direction an interactable can be and still get focus, in degrees. Only used by the spatial query mode.
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (ClampMin = 0.0, ClampMax = 90.0))
+	float InteractionConeHalfAngle;
+
+	// Skip interaction checks while the view stays within the thresholds below.
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction")
+	bool bSkipUnchangedInteractionChecks;
+
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (EditCondition = "bSkipUnchangedInteractionChecks", ClampMin = 0.0))
+	float InteractionCheckMinViewMove;
+
+	// In degrees.
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (EditCondition = "bSkipUnchangedInteractionChecks", ClampMin = 0.0))
+	float InteractionCheckMinViewRotation;
+
+	// Check anyway after this many seconds, so things that show up in front of a still camera get noticed.
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (EditCondition = "bSkipUnchangedInteractionChecks", ClampMin = 0.0))
+	float InteractionCheckMaxSkipTime;
+
+	int32 NumInteractionChecks;
+	int32 NumSkippedInteractionChecks;
+
+	// How many view samples the server keeps per remote player. One is recorded per tick, so this should cover MaxInteractionRewindTime at the server tick rate.
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (ClampMin = 1))
+	int32 ViewHistorySize;
+
+	// How far back in seconds the server is willing to rewind a player's view when validating an interaction. Caps what a client can get away with by lying about their timestamp.
+	UPROPERTY(EditDefaultsOnly, Category = "Interaction", meta = (ClampMin = 0.0))
+	float MaxInteractionRewindTime;
+
+	// Ring buffer of view samples, ViewHistoryNext is where the next one goes.
+	TArray<FInteractionViewSample> ViewHistory;
+	int32 ViewHistoryNext;
+
+	// Set while handling ServerBeginInteract, so BeginInteract() validates against the client's view at the time instead of the current one.
+	float PendingInteractTimeStamp;
+
+	// Reused by every spatial interaction check, so it doesn't allocate.
+	TArray<UInteractionComponent*> InteractionCandidates;
+
+	// The async trace we're waiting on, if any. We don't queue another one until it comes back.
+	FTraceHandle InteractionTraceHandle;
+	FTraceDelegate InteractionTraceDelegate;
+
+	// Stops the timed interact in progress, if there is one.
+	void CancelTimedInteraction();
+
+	// [local] Asks for a promotion unless we just asked for this one, so looking at a world item doesn't send an RPC every check. Asks again after PromoteRequestRetryDelay.
+	void RequestPromoteWorldItem(AWorldItemChunk* Chunk, const int32 RecordId);
+
+	TWeakObjectPtr<AWorldItemChunk> LastPromoteRequestChunk;
+	int32 LastPromoteRequestRecordId;
+	float LastPromoteRequestTime;
+
+	// [local] Let the server know what we're focusing now. The listen server host just sets it directly.
+	void ReportFocus(UInteractionComponent* Interactable);
+
+	// [server] Move us from the interactable we were focusing to this one.
+	void SetReportedFocus(UInteractionComponent* Interactable);
+
+	// What the server has been told we're focusing. Clients keep it too, so they only send changes.
+	TWeakObjectPtr<UInteractionComponent> ReportedFocus;
 
 	UPROPERTY()
 	FInteractionData InteractionData;
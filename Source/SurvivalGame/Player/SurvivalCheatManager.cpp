@@ -0,0 +1,271 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Player/SurvivalCheatManager.h"
+#include "Components/InventoryComponent.h"
+#include "Components/InventoryBenchmark.h"
+#include "Items/Item.h"
+#include "Items/FoodItem.h"
+#include "World/Pickup.h"
+#include "World/PickupSubsystem.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformTime.h"
+#include "Net/Core/PushModel/PushModel.h"
+#include "Engine/NetDriver.h"
+#include "TimerManager.h"
+
+namespace
+{
+	double ElapsedMs(const double StartTime)
+	{
+		return (FPlatformTime::Seconds() - StartTime) * 1000.0;
+	}
+
+	void LoadBenchmarkItemClasses(const TArray<TSoftClassPtr<UItem>>& SoftClasses, TArray<TSubclassOf<UItem>>& OutItemClasses)
+	{
+		for (const TSoftClassPtr<UItem>& SoftClass : SoftClasses)
+		{
+			if (UClass* ItemClass = SoftClass.LoadSynchronous())
+			{
+				OutItemClasses.Add(ItemClass);
+			}
+		}
+
+		// Nothing configured (or the assets are missing), so just use the native classes
+		if (OutItemClasses.Num() == 0)
+		{
+			OutItemClasses.Add(UItem::StaticClass());
+			OutItemClasses.Add(UFoodItem::StaticClass());
+			OutItemClasses.Add(UInventoryBenchmarkItem::StaticClass());
+		}
+	}
+
+	// Replication is measured over several frames, one operation at a time, so each one's bytes can be told apart.
+	struct FReplicationBenchmarkState
+	{
+		FReplicationBenchmarkState(const FInventoryBenchmark& InBenchmark) : Benchmark(InBenchmark) {}
+
+		FInventoryBenchmark Benchmark;
+		TWeakObjectPtr<AActor> Actor;
+		TWeakObjectPtr<UInventoryComponent> Inventory;
+		int32 NumItems = 0;
+		int32 Step = 0;
+		int32 NumOps = 0;
+		int64 StartBytes = 0;
+		FTimerHandle TimerHandle;
+		FString Csv;
+	};
+}
+
+void USurvivalCheatManager::BenchmarkInventory(int32 MaxItems)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	TArray<TSubclassOf<UItem>> ItemClasses;
+	LoadBenchmarkItemClasses(BenchmarkItemClasses, ItemClasses);
+
+	const FInventoryBenchmark Benchmark(ItemClasses);
+
+	MaxItems = FMath::Max(MaxItems, 10);
+
+	// The inventory needs an owner with authority, so give it one that nobody else will touch
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AActor* BenchmarkActor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	if (!BenchmarkActor)
+	{
+		return;
+	}
+
+	TArray<FInventoryBenchmarkResult> Results;
+
+	for (int32 NumItems = 10; NumItems <= MaxItems; NumItems *= 10)
+	{
+		UInventoryComponent* Inventory = NewObject<UInventoryComponent>(BenchmarkActor, NAME_None, RF_Transient);
+		Inventory->SetCapacity(NumItems);
+		Inventory->SetWeightCapacity(BIG_NUMBER);
+		Inventory->RegisterComponent();
+
+		const FInventoryBenchmarkResult& Result = Results.Add_GetRef(Benchmark.Run(Inventory, NumItems));
+
+		UE_LOG(LogTemp, Display, TEXT("BenchmarkInventory: %d items (%d slots) add %.3fms find %.3fms weight %.3fms consume %.3fms remove %.3fms"),
+			Result.NumItems, Result.NumSlots, Result.AddMs, Result.FindMs, Result.WeightMs, Result.ConsumeMs, Result.RemoveMs);
+
+		Inventory->DestroyComponent();
+	}
+
+	BenchmarkActor->Destroy();
+
+	const FString CsvPath = FPaths::ProfilingDir() / FString::Printf(TEXT("InventoryBenchmark-%s.csv"), *FDateTime::Now().ToString());
+	if (FFileHelper::SaveStringToFile(FInventoryBenchmark::ToCsv(Results), *CsvPath))
+	{
+		UE_LOG(LogTemp, Display, TEXT("BenchmarkInventory: wrote %s"), *CsvPath);
+	}
+
+	BenchmarkInventoryReplication(Benchmark, FMath::Min(MaxItems, 1000));
+}
+
+void USurvivalCheatManager::BenchmarkInventoryReplication(const FInventoryBenchmark& Benchmark, const int32 NumItems)
+{
+	UWorld* World = GetWorld();
+	UNetDriver* NetDriver = World ? World->GetNetDriver() : nullptr;
+
+	if (!NetDriver || World->GetNetMode() == NM_Client || NetDriver->ClientConnections.Num() == 0)
+	{
+		UE_LOG(LogTemp, Display, TEXT("BenchmarkInventory: skipping replicated bytes, run this on a server with at least one client connected"));
+		return;
+	}
+
+	FActorSpawnParameters SpawnParams;
+	SpawnParams.ObjectFlags |= RF_Transient;
+	SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+	AActor* BenchmarkActor = World->SpawnActor<AActor>(AActor::StaticClass(), FTransform::Identity, SpawnParams);
+	if (!BenchmarkActor)
+	{
+		return;
+	}
+
+	// Replicated to every client, every net update, so all of an operation's changes go out before the next one runs
+	BenchmarkActor->bAlwaysRelevant = true;
+	BenchmarkActor->SetReplicates(true);
+
+	UInventoryComponent* Inventory = NewObject<UInventoryComponent>(BenchmarkActor, NAME_None, RF_Transient);
+	Inventory->SetCapacity(NumItems);
+	Inventory->SetWeightCapacity(BIG_NUMBER);
+	Inventory->RegisterComponent();
+
+	TSharedRef<FReplicationBenchmarkState> State = MakeShared<FReplicationBenchmarkState>(Benchmark);
+	State->Actor = BenchmarkActor;
+	State->Inventory = Inventory;
+	State->NumItems = NumItems;
+	State->Csv = TEXT("Operation,Ops,Bytes,BytesPerOp\n");
+
+	// Each step records the bytes written since the previous one, then runs the next operation. The first step just lets the channel open.
+	FTimerDelegate StepDelegate = FTimerDelegate::CreateLambda([State, WeakWorld = TWeakObjectPtr<UWorld>(World)]()
+	{
+		static const TCHAR* StepNames[] = { TEXT("Open"), TEXT("Add"), TEXT("Consume"), TEXT("Remove") };
+
+		UWorld* World = WeakWorld.Get();
+		UInventoryComponent* Inventory = State->Inventory.Get();
+		if (!World || !Inventory)
+		{
+			return;
+		}
+
+		const int64 Bytes = Inventory->GetReplicatedBytes() - State->StartBytes;
+		if (State->Step > 0)
+		{
+			const double BytesPerOp = State->NumOps > 0 ? (double)Bytes / State->NumOps : 0.0;
+			State->Csv += FString::Printf(TEXT("%s,%d,%lld,%.2f\n"), StepNames[State->Step], State->NumOps, Bytes, BytesPerOp);
+
+			UE_LOG(LogTemp, Display, TEXT("BenchmarkInventory: %s x%d wrote %lld bytes (%.2f per op)"), StepNames[State->Step], State->NumOps, Bytes, BytesPerOp);
+		}
+
+		State->StartBytes = Inventory->GetReplicatedBytes();
+		++State->Step;
+
+		switch (State->Step)
+		{
+		case 1:
+			State->NumOps = State->NumItems;
+			State->Benchmark.Add(Inventory, State->NumItems);
+			break;
+		case 2:
+			State->NumOps = State->NumItems / 2;
+			State->Benchmark.Consume(Inventory, State->NumItems);
+			break;
+		case 3:
+			State->NumOps = Inventory->GetNumUsedSlots();
+			State->Benchmark.Remove(Inventory);
+			break;
+		default:
+		{
+			World->GetTimerManager().ClearTimer(State->TimerHandle);
+
+			if (AActor* Actor = State->Actor.Get())
+			{
+				Actor->Destroy();
+			}
+
+			const FString CsvPath = FPaths::ProfilingDir() / FString::Printf(TEXT("InventoryReplicationBenchmark-%s.csv"), *FDateTime::Now().ToString());
+			if (FFileHelper::SaveStringToFile(State->Csv, *CsvPath))
+			{
+				UE_LOG(LogTemp, Display, TEXT("BenchmarkInventory: wrote %s"), *CsvPath);
+			}
+			return;
+		}
+		}
+
+		if (AActor* Actor = State->Actor.Get())
+		{
+			Actor->ForceNetUpdate();
+		}
+	});
+
+	// Long enough for a few net updates even on a server ticking at 30hz
+	World->GetTimerManager().SetTimer(State->TimerHandle, StepDelegate, 0.5f, true);
+	UE_LOG(LogTemp, Display, TEXT("BenchmarkInventory: measuring replicated bytes for %d items over the next couple of seconds"), NumItems);
+}
+
+void USurvivalCheatManager::SpawnBenchmarkPickups(int32 NumPickups, bool bKeepAwake, float Spacing)
+{
+	UWorld* World = GetWorld();
+	if (!World)
+	{
+		return;
+	}
+
+	if (World->GetNetMode() == NM_Client)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("SpawnBenchmarkPickups: pickups can only be spawned on the server, try ServerExec \"SpawnBenchmarkPickups %d\""), NumPickups);
+		return;
+	}
+
+	UPickupSubsystem* PickupSubsystem = World->GetSubsystem<UPickupSubsystem>();
+	if (!PickupSubsystem)
+	{
+		return;
+	}
+
+	TSubclassOf<APickup> PickupClass = BenchmarkPickupClass.LoadSynchronous();
+	if (!PickupClass)
+	{
+		PickupClass = APickup::StaticClass();
+	}
+
+	TArray<TSubclassOf<UItem>> ItemClasses;
+	LoadBenchmarkItemClasses(BenchmarkItemClasses, ItemClasses);
+
+	const APlayerController* PC = GetOuterAPlayerController();
+	const FVector Center = PC && PC->GetPawn() ? PC->GetPawn()->GetActorLocation() : FVector::ZeroVector;
+
+	// Keep them further apart than the merge radius, or they'd be merged into a handful of stacks straight away
+	NumPickups = FMath::Max(NumPickups, 1);
+	const int32 GridSize = FMath::CeilToInt(FMath::Sqrt((float)NumPickups));
+	const FVector Origin = Center - FVector(GridSize * Spacing * 0.5f, GridSize * Spacing * 0.5f, 0.f);
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	for (int32 i = 0; i < NumPickups; ++i)
+	{
+		const FVector Location = Origin + FVector((i % GridSize) * Spacing, (i / GridSize) * Spacing, 0.f);
+
+		APickup* Pickup = PickupSubsystem->SpawnPickup(PickupClass, FTransform(Location), ItemClasses[i % ItemClasses.Num()], 1);
+		if (Pickup && bKeepAwake)
+		{
+			Pickup->SetNetDormancy(DORM_Awake);
+		}
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("SpawnBenchmarkPickups: spawned %d %s pickups in %.2fms (push model %s)"), NumPickups, bKeepAwake ? TEXT("awake") : TEXT("dormant"),
+		ElapsedMs(StartTime), IS_PUSH_MODEL_ENABLED() ? TEXT("on") : TEXT("off"));
+}
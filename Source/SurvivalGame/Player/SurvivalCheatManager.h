@@ -0,0 +1,53 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/CheatManager.h"
+#include "SurvivalCheatManager.generated.h"
+
+class UItem;
+class APickup;
+struct FInventoryBenchmark;
+
+/**
+ * Dev commands for the survival game. Only exists in builds that allow cheats.
+ */
+UCLASS(Config = Game)
+class SURVIVALGAME_API USurvivalCheatManager : public UCheatManager
+{
+	GENERATED_BODY()
+
+public:
+	/**
+	 * Fills a throwaway inventory with 10 up to MaxItems items and times add, find, weight, consume and remove.
+	 * Results are logged and written as CSV to the Saved/Profiling folder, so they can be diffed across builds.
+	 * Runs fine headless: -game -nullrhi -ExecCmds="BenchmarkInventory 10000, quit"
+	 * On a server with clients connected it then also measures the bytes ReplicateSubobjects() writes per add, consume and remove.
+	 * The same timings run as the SurvivalGame.Inventory.Benchmark automation test.
+	 */
+	UFUNCTION(Exec)
+	void BenchmarkInventory(int32 MaxItems = 10000);
+
+	/**
+	 * [server] Spawns a grid of pickups around the player, to see what they cost the net driver with lots of players connected.
+	 * bKeepAwake stops them going dormant, so every one of them is considered each net update like before dormancy.
+	 * Compare server net tick time in a CSV capture (csvprofile start/stop) with net.IsPushModelEnabled 1 and 0. Push model is only compiled
+	 * into game builds against a source built engine (see SurvivalGame.Target.cs), elsewhere the log line will say it's off.
+	 * On a dedicated server run it with ServerExec, or -ExecCmds on the server's command line.
+	 */
+	UFUNCTION(Exec)
+	void SpawnBenchmarkPickups(int32 NumPickups = 5000, bool bKeepAwake = true, float Spacing = 200.f);
+
+private:
+	// Runs add, consume and remove on a replicated inventory a few net updates apart, and logs the bytes each one wrote.
+	void BenchmarkInventoryReplication(const FInventoryBenchmark& Benchmark, const int32 NumItems);
+
+	// Items the benchmark cycles through. Should be a mix of stackable and non-stackable classes.
+	UPROPERTY(Config)
+	TArray<TSoftClassPtr<UItem>> BenchmarkItemClasses;
+
+	// What SpawnBenchmarkPickups() spawns. Should be the same pickup class players drop.
+	UPROPERTY(Config)
+	TSoftClassPtr<APickup> BenchmarkPickupClass;
+};
@@ -2,4 +2,9 @@
 
 
 #include "Player/SurvivalPlayerController.h"
+#include "Player/SurvivalCheatManager.h"
 
+ASurvivalPlayerController::ASurvivalPlayerController()
+{
+	CheatClass = USurvivalCheatManager::StaticClass();
+}
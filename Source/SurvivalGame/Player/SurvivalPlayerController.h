@@ -13,5 +13,8 @@ UCLASS()
 class SURVIVALGAME_API ASurvivalPlayerController : public APlayerController
 {
 	GENERATED_BODY()
+
+public:
+	ASurvivalPlayerController();
 	
 };
@@ -4,3 +4,4 @@
 
 #include "CoreMinimal.h"
 
+DECLARE_STATS_GROUP(TEXT("SurvivalGame"), STATGROUP_SurvivalGame, STATCAT_Advanced);
@@ -0,0 +1,63 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Misc/AutomationTest.h"
+#include "Components/InventoryBenchmark.h"
+#include "Components/InventoryComponent.h"
+#include "Items/Item.h"
+#include "Items/FoodItem.h"
+#include "Engine/Engine.h"
+#include "Engine/World.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Same timings as the BenchmarkInventory cheat, in a throwaway game world. Runs headless:
+ * -nullrhi -ExecCmds="Automation RunTests SurvivalGame.Inventory.Benchmark; Quit"
+ */
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FInventoryBenchmarkTest, "SurvivalGame.Inventory.Benchmark",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::PerfFilter)
+
+bool FInventoryBenchmarkTest::RunTest(const FString& Parameters)
+{
+	UWorld* World = UWorld::CreateWorld(EWorldType::Game, false);
+	FWorldContext& WorldContext = GEngine->CreateNewWorldContext(EWorldType::Game);
+	WorldContext.SetCurrentWorld(World);
+
+	World->InitializeActorsForPlay(FURL());
+	World->BeginPlay();
+
+	AActor* BenchmarkActor = World->SpawnActor<AActor>();
+	TestNotNull(TEXT("Benchmark actor spawned"), BenchmarkActor);
+
+	if (BenchmarkActor)
+	{
+		const FInventoryBenchmark Benchmark({ UItem::StaticClass(), UFoodItem::StaticClass(), UInventoryBenchmarkItem::StaticClass() });
+
+		for (int32 NumItems = 10; NumItems <= 10000; NumItems *= 10)
+		{
+			UInventoryComponent* Inventory = NewObject<UInventoryComponent>(BenchmarkActor);
+			Inventory->SetCapacity(NumItems);
+			Inventory->SetWeightCapacity(BIG_NUMBER);
+			Inventory->RegisterComponent();
+
+			const FInventoryBenchmarkResult Result = Benchmark.Run(Inventory, NumItems);
+
+			// Every add should have taken a slot of its own, otherwise we're timing the "full stack" early out
+			TestEqual(FString::Printf(TEXT("%d adds fill %d slots"), NumItems, NumItems), Result.NumSlots, NumItems);
+			TestEqual(FString::Printf(TEXT("Inventory of %d is empty afterwards"), NumItems), Inventory->GetNumUsedSlots(), 0);
+
+			AddInfo(FString::Printf(TEXT("%d items: add %.3fms find %.3fms weight %.3fms consume %.3fms remove %.3fms"),
+				Result.NumItems, Result.AddMs, Result.FindMs, Result.WeightMs, Result.ConsumeMs, Result.RemoveMs));
+
+			Inventory->DestroyComponent();
+		}
+	}
+
+	GEngine->DestroyWorldContext(World);
+	World->DestroyWorld(false);
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
@@ -0,0 +1,165 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "Widgets/InteractionPromptSubsystem.h"
+#include "Widgets/InteractionWidget.h"
+#include "Components/InteractionComponent.h"
+#include "Engine/LocalPlayer.h"
+#include "GameFramework/PlayerController.h"
+
+UInteractionPromptSubsystem::UInteractionPromptSubsystem() :
+	Prompt(nullptr)
+{
+
+}
+
+void UInteractionPromptSubsystem::ShowPrompt(UInteractionComponent* Interactable)
+{
+	APlayerController* PlayerController = GetLocalPlayer() ? GetLocalPlayer()->GetPlayerController(Interactable->GetWorld()) : nullptr;
+	if (!PlayerController)
+	{
+		return;
+	}
+
+	UInteractionWidget* NewPrompt = GetOrCreatePrompt(Interactable->GetWidgetClass(), PlayerController);
+	if (!NewPrompt)
+	{
+		return;
+	}
+
+	if (Prompt && Prompt != NewPrompt)
+	{
+		CollapsePrompt();
+	}
+
+	Prompt = NewPrompt;
+	PromptInteractable = Interactable;
+
+	Prompt->UpdateInteractionWidget(Interactable);
+	UpdatePromptPosition();
+}
+
+UInteractionWidget* UInteractionPromptSubsystem::GetOrCreatePrompt(TSubclassOf<UInteractionWidget> PromptClass, APlayerController* PlayerController)
+{
+	if (!PromptClass)
+	{
+		return nullptr;
+	}
+
+	UInteractionWidget*& ClassPrompt = Prompts.FindOrAdd(PromptClass);
+	if (ClassPrompt && (ClassPrompt->GetOwningPlayer() != PlayerController || !ClassPrompt->IsInViewport()))
+	{
+		if (Prompt == ClassPrompt)
+		{
+			PromptInteractable.Reset();
+			Prompt = nullptr;
+		}
+
+		ClassPrompt->RemoveFromParent();
+		ClassPrompt = nullptr;
+	}
+
+	if (!ClassPrompt)
+	{
+		ClassPrompt = CreateWidget<UInteractionWidget>(PlayerController, PromptClass);
+		if (ClassPrompt)
+		{
+			ClassPrompt->SetAlignmentInViewport(FVector2D(0.5f, 0.5f));
+			ClassPrompt->AddToPlayerScreen();
+		}
+	}
+
+	return ClassPrompt;
+}
+
+void UInteractionPromptSubsystem::HidePrompt(UInteractionComponent* Interactable)
+{
+	if (Prompt && PromptInteractable == Interactable)
+	{
+		CollapsePrompt();
+	}
+}
+
+void UInteractionPromptSubsystem::CollapsePrompt()
+{
+	PromptInteractable.Reset();
+	Prompt->SetVisibility(ESlateVisibility::Collapsed);
+
+	// Focus usually ends before the interact does, and after this the interactable can't reach the prompt to cancel progress
+	if (Prompt->IsInteractInProgress())
+	{
+		Prompt->EndInteractProgress(false);
+	}
+}
+
+void UInteractionPromptSubsystem::RefreshPrompt(UInteractionComponent* Interactable)
+{
+	if (Prompt && PromptInteractable == Interactable)
+	{
+		Prompt->UpdateInteractionWidget(Interactable);
+	}
+}
+
+void UInteractionPromptSubsystem::Deinitialize()
+{
+	for (const TPair<UClass*, UInteractionWidget*>& Pair : Prompts)
+	{
+		if (Pair.Value)
+		{
+			Pair.Value->RemoveFromParent();
+		}
+	}
+	Prompts.Empty();
+	Prompt = nullptr;
+
+	Super::Deinitialize();
+}
+
+void UInteractionPromptSubsystem::Tick(float DeltaTime)
+{
+	UpdatePromptPosition();
+}
+
+bool UInteractionPromptSubsystem::IsTickable() const
+{
+	return Prompt != nullptr && Prompt->GetVisibility() != ESlateVisibility::Collapsed;
+}
+
+ETickableTickType UInteractionPromptSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+TStatId UInteractionPromptSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInteractionPromptSubsystem, STATGROUP_Tickables);
+}
+
+void UInteractionPromptSubsystem::UpdatePromptPosition()
+{
+	UInteractionComponent* Interactable = PromptInteractable.Get();
+	APlayerController* PlayerController = Prompt ? Prompt->GetOwningPlayer() : nullptr;
+
+	// The interactable went away without ending focus, e.g. a pickup someone else took
+	if (!Interactable || !PlayerController)
+	{
+		if (Prompt)
+		{
+			PromptInteractable.Reset();
+			Prompt->SetVisibility(ESlateVisibility::Collapsed);
+		}
+		return;
+	}
+
+	FVector2D ScreenPosition;
+	if (PlayerController->ProjectWorldLocationToScreen(Interactable->GetComponentLocation(), ScreenPosition, true))
+	{
+		Prompt->SetPositionInViewport(ScreenPosition, true);
+		Prompt->SetVisibility(ESlateVisibility::HitTestInvisible);
+	}
+	else
+	{
+		// Behind the camera, keep ticking so it comes back once it's in view again
+		Prompt->SetVisibility(ESlateVisibility::Hidden);
+	}
+}
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/LocalPlayerSubsystem.h"
+#include "Tickable.h"
+#include "InteractionPromptSubsystem.generated.h"
+
+class UInteractionComponent;
+class UInteractionWidget;
+class APlayerController;
+
+/**
+ * The interaction prompt a local player sees. Interaction components using the shared prompt don't create a widget of their own,
+ * instead this subsystem creates one UInteractionWidget per widget class on first use and moves it over whatever the player is focusing.
+ */
+UCLASS()
+class SURVIVALGAME_API UInteractionPromptSubsystem : public ULocalPlayerSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UInteractionPromptSubsystem();
+
+	// Show the prompt for this interactable, replacing whatever it was showing before.
+	void ShowPrompt(UInteractionComponent* Interactable);
+
+	// Hide the prompt, if it's currently showing this interactable.
+	void HidePrompt(UInteractionComponent* Interactable);
+
+	// Update the prompt's contents, if it's currently showing this interactable.
+	void RefreshPrompt(UInteractionComponent* Interactable);
+
+	FORCEINLINE UInteractionComponent* GetPromptInteractable() const { return PromptInteractable.Get(); }
+
+	// The prompt widget, if it's currently showing this interactable.
+	FORCEINLINE UInteractionWidget* GetPromptFor(const UInteractionComponent* Interactable) const
+	{
+		return PromptInteractable.Get() == Interactable ? Prompt : nullptr;
+	}
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	// Keeps the prompt over the interactable on screen.
+	void UpdatePromptPosition();
+
+	// The prompt for this widget class, made again if the one we had belongs to an old player controller or left the viewport (e.g. after map travel).
+	UInteractionWidget* GetOrCreatePrompt(TSubclassOf<UInteractionWidget> PromptClass, APlayerController* PlayerController);
+
+	// Collapse the showing prompt and forget what it was showing.
+	void CollapsePrompt();
+
+	// One prompt per widget class, created the first time something using that class is focused.
+	UPROPERTY()
+	TMap<UClass*, UInteractionWidget*> Prompts;
+
+	// Whichever of the prompts is currently in use.
+	UPROPERTY()
+	UInteractionWidget* Prompt;
+
+	TWeakObjectPtr<UInteractionComponent> PromptInteractable;
+};
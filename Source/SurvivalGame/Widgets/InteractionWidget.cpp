@@ -8,4 +8,27 @@ void UInteractionWidget::UpdateInteractionWidget(UInteractionComponent* Interact
 {
 	OwningInteractionComponent = InteractionComponent;
 	OnUpdateInteractionWidget();
+}
+
+void UInteractionWidget::BeginInteractProgress(const FInteractionProgress& Progress)
+{
+	InteractProgress = Progress;
+	bInteractInProgress = true;
+	OnInteractProgressBegin(Progress);
+}
+
+void UInteractionWidget::EndInteractProgress(const bool bCompleted)
+{
+	bInteractInProgress = false;
+	OnInteractProgressEnd(bCompleted);
+}
+
+float UInteractionWidget::GetInteractProgressAlpha() const
+{
+	if (!bInteractInProgress || !GetWorld())
+	{
+		return 0.f;
+	}
+
+	return InteractProgress.GetAlpha(GetWorld()->GetTimeSeconds());
 }
\ No newline at end of file
@@ -4,6 +4,7 @@
 
 #include "CoreMinimal.h"
 #include "Blueprint/UserWidget.h"
+#include "Components/InteractionComponent.h"
 #include "InteractionWidget.generated.h"
 
 class UInteractionComponent;
@@ -23,7 +24,30 @@ public:
 	UFUNCTION(BlueprintImplementableEvent)
 	void OnUpdateInteractionWidget();
 
+	// Called by the interaction component when the local player starts or stops a timed interact with it.
+	void BeginInteractProgress(const FInteractionProgress& Progress);
+	void EndInteractProgress(const bool bCompleted);
+
+	// Start animating progress here, e.g. with a timer at Progress.UpdateRate that reads GetInteractProgressAlpha().
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnInteractProgressBegin(const FInteractionProgress& Progress);
+
+	UFUNCTION(BlueprintImplementableEvent)
+	void OnInteractProgressEnd(bool bCompleted);
+
+	FORCEINLINE bool IsInteractInProgress() const { return bInteractInProgress; }
+
+	// 0-1 progress of the current interact, worked out from the progress we were given. Cheap enough to call every frame.
+	UFUNCTION(BlueprintPure, Category = "Interaction")
+	float GetInteractProgressAlpha() const;
+
 private:
 	UPROPERTY(BlueprintReadOnly, Category = "Interaction", meta = (ExposeOnSpawn, AllowPrivateAccess = "true"))
 	UInteractionComponent* OwningInteractionComponent;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction", meta = (AllowPrivateAccess = "true"))
+	FInteractionProgress InteractProgress;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Interaction", meta = (AllowPrivateAccess = "true"))
+	bool bInteractInProgress;
 };
@@ -0,0 +1,114 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/HighlightSubsystem.h"
+#include "SurvivalGame.h"
+#include "Components/InteractionComponent.h"
+#include "Components/PrimitiveComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Apply Highlights"), STAT_ApplyHighlights, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Highlight State Changes"), STAT_HighlightStateChanges, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Highlight Primitive Updates"), STAT_HighlightPrimitiveUpdates, STATGROUP_SurvivalGame);
+
+UHighlightSubsystem::UHighlightSubsystem() :
+	NumStateChangesLastFrame(0), NumPrimitiveUpdatesLastFrame(0)
+{
+
+}
+
+void UHighlightSubsystem::RegisterInteractable(UInteractionComponent* Interactable)
+{
+	AActor* Owner = Interactable ? Interactable->GetOwner() : nullptr;
+	if (!Owner || Entries.Contains(Interactable))
+	{
+		return;
+	}
+
+	FHighlightEntry& Entry = Entries.Add(Interactable);
+
+	TInlineComponentArray<UPrimitiveComponent*> Primitives(Owner);
+	for (UPrimitiveComponent* Primitive : Primitives)
+	{
+		Entry.Primitives.Add(Primitive);
+	}
+}
+
+void UHighlightSubsystem::UnregisterInteractable(UInteractionComponent* Interactable)
+{
+	Entries.Remove(Interactable);
+	PendingChanges.Remove(Interactable);
+}
+
+void UHighlightSubsystem::SetHighlighted(UInteractionComponent* Interactable, const bool bHighlighted)
+{
+	if (FHighlightEntry* Entry = Entries.Find(Interactable))
+	{
+		Entry->bWantsHighlight = bHighlighted;
+		PendingChanges.Add(Interactable);
+	}
+}
+
+void UHighlightSubsystem::Deinitialize()
+{
+	Entries.Empty();
+	PendingChanges.Empty();
+
+	Super::Deinitialize();
+}
+
+void UHighlightSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_ApplyHighlights);
+
+	NumStateChangesLastFrame = 0;
+	NumPrimitiveUpdatesLastFrame = 0;
+
+	for (const TWeakObjectPtr<UInteractionComponent>& Interactable : PendingChanges)
+	{
+		FHighlightEntry* Entry = Entries.Find(Interactable);
+
+		// Focused and unfocused in the same frame, nothing to do
+		if (!Entry || Entry->bWantsHighlight == Entry->bHighlighted)
+		{
+			continue;
+		}
+
+		Entry->bHighlighted = Entry->bWantsHighlight;
+		++NumStateChangesLastFrame;
+
+		for (const TWeakObjectPtr<UPrimitiveComponent>& Primitive : Entry->Primitives)
+		{
+			if (Primitive.IsValid())
+			{
+				Primitive->SetRenderCustomDepth(Entry->bHighlighted);
+				++NumPrimitiveUpdatesLastFrame;
+			}
+		}
+	}
+
+	PendingChanges.Reset();
+
+	INC_DWORD_STAT_BY(STAT_HighlightStateChanges, NumStateChangesLastFrame);
+	INC_DWORD_STAT_BY(STAT_HighlightPrimitiveUpdates, NumPrimitiveUpdatesLastFrame);
+}
+
+bool UHighlightSubsystem::IsTickable() const
+{
+	return PendingChanges.Num() > 0;
+}
+
+ETickableTickType UHighlightSubsystem::GetTickableTickType() const
+{
+	// The class default object gets constructed like any other, but shouldn't tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UHighlightSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UHighlightSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UHighlightSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,59 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "HighlightSubsystem.generated.h"
+
+class UInteractionComponent;
+class UPrimitiveComponent;
+
+/**
+ * Turns the focus outline (custom depth) on and off for interactables. Each interactable's primitives are looked up once when it registers,
+ * and outline changes are applied once per frame, so sweeping the camera over a pile of loot only touches render state for what actually changed.
+ */
+UCLASS()
+class SURVIVALGAME_API UHighlightSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UHighlightSubsystem();
+
+	void RegisterInteractable(UInteractionComponent* Interactable);
+	void UnregisterInteractable(UInteractionComponent* Interactable);
+
+	// Ask for the interactable's outline to be shown or hidden. Applied on the next tick, and dropped if it gets flipped back before then.
+	void SetHighlighted(UInteractionComponent* Interactable, const bool bHighlighted);
+
+	// How many interactables changed outline state and how many primitives were updated for that, on the last tick that applied changes.
+	FORCEINLINE int32 GetNumStateChangesLastFrame() const { return NumStateChangesLastFrame; }
+	FORCEINLINE int32 GetNumPrimitiveUpdatesLastFrame() const { return NumPrimitiveUpdatesLastFrame; }
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	struct FHighlightEntry
+	{
+		TArray<TWeakObjectPtr<UPrimitiveComponent>> Primitives;
+		bool bWantsHighlight = false;
+		bool bHighlighted = false;
+	};
+
+	TMap<TWeakObjectPtr<UInteractionComponent>, FHighlightEntry> Entries;
+
+	// Interactables whose wanted state may differ from what's applied.
+	TSet<TWeakObjectPtr<UInteractionComponent>> PendingChanges;
+
+	int32 NumStateChangesLastFrame;
+	int32 NumPrimitiveUpdatesLastFrame;
+};
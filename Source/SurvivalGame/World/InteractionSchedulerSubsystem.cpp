@@ -0,0 +1,118 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/InteractionSchedulerSubsystem.h"
+#include "SurvivalGame.h"
+#include "Player/SurvivalCharacter.h"
+#include "Components/InteractionComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Complete Scheduled Interactions"), STAT_CompleteScheduledInteractions, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Scheduled Interactions"), STAT_ScheduledInteractions, STATGROUP_SurvivalGame);
+
+float UInteractionSchedulerSubsystem::ScheduleInteraction(ASurvivalCharacter* Character, UInteractionComponent* Interactable, const float Duration)
+{
+	CancelInteraction(Character);
+
+	FScheduledInteraction& Interaction = Interactions.AddDefaulted_GetRef();
+	Interaction.Character = Character;
+	Interaction.Interactable = Interactable;
+	Interaction.EndTime = GetWorld()->GetTimeSeconds() + Duration;
+
+	INC_DWORD_STAT(STAT_ScheduledInteractions);
+
+	return Interaction.EndTime;
+}
+
+void UInteractionSchedulerSubsystem::CancelInteraction(ASurvivalCharacter* Character)
+{
+	const int32 Index = Interactions.IndexOfByPredicate([Character](const FScheduledInteraction& Interaction)
+	{
+		return Interaction.Character == Character;
+	});
+
+	if (Index != INDEX_NONE)
+	{
+		Interactions.RemoveAtSwap(Index, 1, false);
+		DEC_DWORD_STAT(STAT_ScheduledInteractions);
+	}
+}
+
+void UInteractionSchedulerSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_ScheduledInteractions, Interactions.Num());
+	Interactions.Empty();
+	CompletedInteractions.Empty();
+
+	Super::Deinitialize();
+}
+
+void UInteractionSchedulerSubsystem::Tick(float DeltaTime)
+{
+	SCOPE_CYCLE_COUNTER(STAT_CompleteScheduledInteractions);
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	// Pull everything that's done out first, so completing an interact can start or cancel others without upsetting the loop
+	CompletedInteractions.Reset();
+	for (int32 i = Interactions.Num() - 1; i >= 0; --i)
+	{
+		const FScheduledInteraction& Interaction = Interactions[i];
+
+		if (!Interaction.Character.IsValid() || !Interaction.Interactable.IsValid())
+		{
+			Interactions.RemoveAtSwap(i, 1, false);
+			DEC_DWORD_STAT(STAT_ScheduledInteractions);
+		}
+		else if (Interaction.EndTime <= TimeSeconds)
+		{
+			CompletedInteractions.Add(Interaction);
+			Interactions.RemoveAtSwap(i, 1, false);
+			DEC_DWORD_STAT(STAT_ScheduledInteractions);
+		}
+	}
+
+	if (CompletedInteractions.Num() == 0)
+	{
+		return;
+	}
+
+	// Validate the whole batch first, drop the ones that fail
+	for (int32 i = CompletedInteractions.Num() - 1; i >= 0; --i)
+	{
+		const FScheduledInteraction& Interaction = CompletedInteractions[i];
+		ASurvivalCharacter* Character = Interaction.Character.Get();
+
+		if (!Character || !Character->ValidateTimedInteraction(Interaction.Interactable.Get()))
+		{
+			CompletedInteractions.RemoveAtSwap(i, 1, false);
+		}
+	}
+
+	for (const FScheduledInteraction& Interaction : CompletedInteractions)
+	{
+		if (ASurvivalCharacter* Character = Interaction.Character.Get())
+		{
+			Character->Interact();
+		}
+	}
+}
+
+bool UInteractionSchedulerSubsystem::IsTickable() const
+{
+	return Interactions.Num() > 0;
+}
+
+ETickableTickType UInteractionSchedulerSubsystem::GetTickableTickType() const
+{
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UInteractionSchedulerSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UInteractionSchedulerSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UInteractionSchedulerSubsystem, STATGROUP_Tickables);
+}
@@ -0,0 +1,52 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "InteractionSchedulerSubsystem.generated.h"
+
+class ASurvivalCharacter;
+class UInteractionComponent;
+
+// A timed interact that's in progress.
+struct FScheduledInteraction
+{
+	TWeakObjectPtr<ASurvivalCharacter> Character;
+	TWeakObjectPtr<UInteractionComponent> Interactable;
+	float EndTime;
+};
+
+/**
+ * Runs every timed interact in the world, instead of each character having a timer of its own.
+ * Interacts live in one array that's checked once per frame. The ones that finished are validated together and then completed together.
+ */
+UCLASS()
+class SURVIVALGAME_API UInteractionSchedulerSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	// Start a timed interact for this character, replacing any it already has. Returns the world time it will complete at.
+	float ScheduleInteraction(ASurvivalCharacter* Character, UInteractionComponent* Interactable, const float Duration);
+
+	void CancelInteraction(ASurvivalCharacter* Character);
+
+	FORCEINLINE int32 GetNumScheduledInteractions() const { return Interactions.Num(); }
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	TArray<FScheduledInteraction> Interactions;
+
+	// Interacts that finished this frame, kept around so completing them doesn't allocate.
+	TArray<FScheduledInteraction> CompletedInteractions;
+};
@@ -0,0 +1,139 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/InteractionSubsystem.h"
+#include "SurvivalGame.h"
+#include "Components/InteractionComponent.h"
+
+DECLARE_CYCLE_STAT(TEXT("Interactables Cone Query"), STAT_InteractablesConeQuery, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Registered Interactables"), STAT_RegisteredInteractables, STATGROUP_SurvivalGame);
+
+UInteractionSubsystem::UInteractionSubsystem() :
+	CellSize(1000.f)
+{
+
+}
+
+void UInteractionSubsystem::RegisterInteractable(UInteractionComponent* Interactable)
+{
+	if (!Interactable || InteractableCells.Contains(Interactable))
+	{
+		return;
+	}
+
+	const FIntPoint Cell = GetCell(Interactable->GetComponentLocation());
+	Cells.FindOrAdd(Cell).Add(Interactable);
+	InteractableCells.Add(Interactable, Cell);
+
+	INC_DWORD_STAT(STAT_RegisteredInteractables);
+}
+
+void UInteractionSubsystem::UnregisterInteractable(UInteractionComponent* Interactable)
+{
+	FIntPoint Cell;
+	if (!InteractableCells.RemoveAndCopyValue(Interactable, Cell))
+	{
+		return;
+	}
+
+	if (TArray<UInteractionComponent*>* CellInteractables = Cells.Find(Cell))
+	{
+		CellInteractables->RemoveSingleSwap(Interactable, false);
+
+		if (CellInteractables->Num() == 0)
+		{
+			Cells.Remove(Cell);
+		}
+	}
+
+	DEC_DWORD_STAT(STAT_RegisteredInteractables);
+}
+
+void UInteractionSubsystem::UpdateInteractable(UInteractionComponent* Interactable)
+{
+	FIntPoint* OldCell = InteractableCells.Find(Interactable);
+	if (!OldCell)
+	{
+		return;
+	}
+
+	const FIntPoint NewCell = GetCell(Interactable->GetComponentLocation());
+	if (NewCell != *OldCell)
+	{
+		// Cheap enough, and pickups don't move often once they've settled
+		UnregisterInteractable(Interactable);
+		RegisterInteractable(Interactable);
+	}
+}
+
+void UInteractionSubsystem::FindInteractablesInCone(const FVector& Origin, const FVector& Direction, const float MaxDistance, const float ConeHalfAngle, TArray<UInteractionComponent*>& OutInteractables) const
+{
+	SCOPE_CYCLE_COUNTER(STAT_InteractablesConeQuery);
+
+	OutInteractables.Reset();
+
+	const FVector ViewDirection = Direction.GetSafeNormal();
+	const float MinDot = FMath::Cos(FMath::DegreesToRadians(ConeHalfAngle));
+
+	const FIntPoint MinCell = GetCell(Origin - FVector(MaxDistance));
+	const FIntPoint MaxCell = GetCell(Origin + FVector(MaxDistance));
+
+	// How far each candidate is off the view direction, to sort on after
+	TArray<TPair<float, UInteractionComponent*>, TInlineAllocator<16>> Candidates;
+
+	for (int32 X = MinCell.X; X <= MaxCell.X; ++X)
+	{
+		for (int32 Y = MinCell.Y; Y <= MaxCell.Y; ++Y)
+		{
+			const TArray<UInteractionComponent*>* CellInteractables = Cells.Find(FIntPoint(X, Y));
+			if (!CellInteractables)
+			{
+				continue;
+			}
+
+			for (UInteractionComponent* Interactable : *CellInteractables)
+			{
+				const FVector ToInteractable = Interactable->GetComponentLocation() - Origin;
+				const float DistanceSquared = ToInteractable.SizeSquared();
+				const float InteractableDistance = FMath::Min(MaxDistance, Interactable->GetInteractionDistance());
+
+				if (DistanceSquared > FMath::Square(InteractableDistance))
+				{
+					continue;
+				}
+
+				// Standing right on top of it counts as looking at it
+				const float Dot = DistanceSquared > KINDA_SMALL_NUMBER ? (ToInteractable * FMath::InvSqrt(DistanceSquared)) | ViewDirection : 1.f;
+				if (Dot >= MinDot)
+				{
+					Candidates.Emplace(Dot, Interactable);
+				}
+			}
+		}
+	}
+
+	Candidates.Sort([](const TPair<float, UInteractionComponent*>& A, const TPair<float, UInteractionComponent*>& B)
+	{
+		return A.Key > B.Key;
+	});
+
+	for (const TPair<float, UInteractionComponent*>& Candidate : Candidates)
+	{
+		OutInteractables.Add(Candidate.Value);
+	}
+}
+
+void UInteractionSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_RegisteredInteractables, InteractableCells.Num());
+
+	Cells.Empty();
+	InteractableCells.Empty();
+
+	Super::Deinitialize();
+}
+
+FIntPoint UInteractionSubsystem::GetCell(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / CellSize), FMath::FloorToInt(Location.Y / CellSize));
+}
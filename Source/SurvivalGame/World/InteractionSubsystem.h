@@ -0,0 +1,51 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "InteractionSubsystem.generated.h"
+
+class UInteractionComponent;
+
+/**
+ * Keeps every active interaction component in a 2D grid, so characters can find interactables around them
+ * without tracing against the physics scene and searching the hit actor's components.
+ * Interaction components register themselves while active and keep their cell up to date as they move.
+ */
+UCLASS(Config = Game)
+class SURVIVALGAME_API UInteractionSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UInteractionSubsystem();
+
+	void RegisterInteractable(UInteractionComponent* Interactable);
+	void UnregisterInteractable(UInteractionComponent* Interactable);
+
+	// Moves the interactable to the right cell if it has left its old one.
+	void UpdateInteractable(UInteractionComponent* Interactable);
+
+	/** Find the active interactables within MaxDistance of Origin and within ConeHalfAngle degrees of Direction.
+	 * Each interactable's own interaction distance is respected too. OutInteractables is sorted best first, the one closest to the center of the cone.
+	 * Doesn't check line of sight, that's up to the caller. */
+	void FindInteractablesInCone(const FVector& Origin, const FVector& Direction, const float MaxDistance, const float ConeHalfAngle, TArray<UInteractionComponent*>& OutInteractables) const;
+
+	FORCEINLINE int32 GetNumInteractables() const { return InteractableCells.Num(); }
+
+	virtual void Deinitialize() override;
+
+private:
+	FIntPoint GetCell(const FVector& Location) const;
+
+	// Interactables in each cell. Components unregister before they go away, so we don't need to hold references.
+	TMap<FIntPoint, TArray<UInteractionComponent*>> Cells;
+
+	// The cell every registered interactable is in.
+	TMap<UInteractionComponent*, FIntPoint> InteractableCells;
+
+	// Size of a grid cell in cm. Around the interaction check distance works well, as queries then only touch a few cells.
+	UPROPERTY(Config)
+	float CellSize;
+};
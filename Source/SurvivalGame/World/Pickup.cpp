@@ -2,17 +2,26 @@
 
 
 #include "World/Pickup.h"
+#include "SurvivalGame.h"
 #include "Items/Item.h"
+#include "Items/ItemPoolSubsystem.h"
+#include "World/PickupSubsystem.h"
 #include "Player/SurvivalCharacter.h"
 #include "Components/StaticMeshComponent.h"
 #include "Components/InteractionComponent.h"
 #include "Components/InventoryComponent.h"
 
 #include "Net/UnrealNetwork.h"
+#include "Net/Core/PushModel/PushModel.h"
 #include "Engine/ActorChannel.h"
 
+DECLARE_CYCLE_STAT(TEXT("Initialize Pickup"), STAT_InitializePickup, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pickup Items Deferred"), STAT_PickupItemsDeferred, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Items Created On Demand"), STAT_PickupItemsCreatedOnDemand, STATGROUP_SurvivalGame);
+
 // Sets default values
-APickup::APickup()
+APickup::APickup() :
+	bPooled(false), bItemDeferred(false), bPromotedWorldItem(false), PickupIndex(INDEX_NONE)
 {
  	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
 	PrimaryActorTick.bCanEverTick = false;
@@ -28,18 +37,40 @@ APickup::APickup()
 	InteractionComponent->SetInteractableNameText(FText::FromString("Pickup"));
 	InteractionComponent->SetInteractableActionText(FText::FromString("Take"));
 	InteractionComponent->OnInteract.AddDynamic(this, &APickup::OnTakePickup);
+	InteractionComponent->OnBeginFocus.AddDynamic(this, &APickup::OnPickupFocused);
 	InteractionComponent->SetupAttachment(PickupMesh);
 
 	bReplicates = true;
 	//SetReplicates(true); // In order to networking stuff works we need to SetReplicates to true!
+
+	// Pickups barely ever change once they're in the world, so let the net driver forget about them after the first replication.
+	// Anything that changes the item wakes us back up, see UItem::MarkDirtyForReplication().
+	NetDormancy = DORM_DormantAll;
 }
 
 void APickup::InitializePickup(const TSubclassOf<class UItem> ItemClass, const int32 Quantity)
 {
+	SCOPE_CYCLE_COUNTER(STAT_InitializePickup);
+
 	if (HasAuthority() && ItemClass && Quantity > 0)
 	{
-		Item = NewObject<UItem>(this, ItemClass);
+		if (bItemDeferred)
+		{
+			bItemDeferred = false;
+			DEC_DWORD_STAT(STAT_PickupItemsDeferred);
+		}
+
+		// Swapping the item changes our replicated Item property, so clients need to hear about it even if we were dormant
+		FlushNetDormancy();
+
+		if (Item)
+		{
+			UItemPoolSubsystem::Release(Item);
+		}
+
+		Item = UItemPoolSubsystem::Acquire(this, ItemClass);
 		Item->SetQuantity(Quantity);
+		MARK_PROPERTY_DIRTY_FROM_NAME(APickup, Item, this);
 
 		OnRep_Item();
 
@@ -55,10 +86,26 @@ void APickup::InitializePickup(const TSubclassOf<class UItem> ItemClass, const i
 void APickup::BeginPlay()
 {
 	Super::BeginPlay();
+
+	if (HasAuthority())
+	{
+		if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
+		{
+			PickupSubsystem->RegisterPickup(this);
+		}
+	}
 	
-	if (HasAuthority() && ItemTemplate && bNetStartup)
+	// Level placed pickups hold off on creating their item, see EnsureItem(). Clients load the same template with the map,
+	// so everyone can show what the pickup is in the meantime.
+	if (ItemTemplate && bNetStartup)
 	{
-		InitializePickup(ItemTemplate->GetClass(), ItemTemplate->GetQuantity());
+		if (HasAuthority() && !Item)
+		{
+			bItemDeferred = true;
+			INC_DWORD_STAT(STAT_PickupItemsDeferred);
+		}
+
+		InteractionComponent->SetInteractableNameText(ItemTemplate->GetItemDisplayName());
 	}
 
 	/** If pickup was spawned in at runtime,  ensure that it matches the rotation of the ground that it was dropped on
@@ -75,11 +122,56 @@ void APickup::BeginPlay()
 	}
 }
 
+void APickup::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	Super::EndPlay(EndPlayReason);
+
+	if (HasAuthority())
+	{
+		if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
+		{
+			PickupSubsystem->UnregisterPickup(this);
+		}
+	}
+
+	if (bItemDeferred)
+	{
+		bItemDeferred = false;
+		DEC_DWORD_STAT(STAT_PickupItemsDeferred);
+	}
+
+	// Our item goes back to the pool rather than being left for the GC.
+	if (HasAuthority() && Item)
+	{
+		UItemPoolSubsystem::Release(Item);
+		Item = nullptr;
+	}
+}
+
 void APickup::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
 {
 	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
 
-	DOREPLIFETIME(APickup, Item);
+	FDoRepLifetimeParams Params;
+	Params.bIsPushBased = true;
+
+	DOREPLIFETIME_WITH_PARAMS_FAST(APickup, Item, Params);
+	DOREPLIFETIME_WITH_PARAMS_FAST(APickup, bPooled, Params);
+}
+
+void APickup::EnsureItem()
+{
+	if (bItemDeferred && HasAuthority() && ItemTemplate)
+	{
+		INC_DWORD_STAT(STAT_PickupItemsCreatedOnDemand);
+		InitializePickup(ItemTemplate->GetClass(), ItemTemplate->GetQuantity());
+	}
+}
+
+void APickup::OnPickupFocused(ASurvivalCharacter* Character)
+{
+	// The listen server host and standalone players don't need a channel to see us, so this is how they get the item
+	EnsureItem();
 }
 
 bool APickup::ReplicateSubobjects(UActorChannel* Channel, FOutBunch* Bunch, FReplicationFlags* RepFlags)
@@ -119,6 +211,8 @@ void APickup::OnTakePickup(ASurvivalCharacter* Taker)
 		return;
 	}
 
+	EnsureItem();
+
 	// Not 100% sure Pending kill check is needed but should prevent player from taking a pickup another player has already tried taking
 	if (HasAuthority() && !IsPendingKillPending() && Item)
 	{
@@ -132,12 +226,86 @@ void APickup::OnTakePickup(ASurvivalCharacter* Taker)
 			}
 			else if (AddResult.ActualAmountGiven >= Item->GetQuantity())
 			{
-				Destroy();
+				if (UPickupSubsystem* PickupSubsystem = GetWorld()->GetSubsystem<UPickupSubsystem>())
+				{
+					PickupSubsystem->ReleasePickup(this);
+				}
+				else
+				{
+					Destroy();
+				}
 			}
 		}
 	}
 }
 
+void APickup::SetPooled(const bool bNewPooled)
+{
+	if (HasAuthority() && bNewPooled != bPooled)
+	{
+		// Pooled pickups need the net driver to look at them, or it would never notice they stopped being relevant
+		SetNetDormancy(bNewPooled ? DORM_Awake : DORM_DormantAll);
+		FlushNetDormancy();
+
+		bPooled = bNewPooled;
+		MARK_PROPERTY_DIRTY_FROM_NAME(APickup, bPooled, this);
+		OnRep_Pooled();
+
+		if (bPooled)
+		{
+			bPromotedWorldItem = false;
+		}
+
+		if (bPooled && Item)
+		{
+			// Our item is known to clients so it won't go back to the item pool, but we still shouldn't hold on to it
+			UItemPoolSubsystem::Release(Item);
+			Item = nullptr;
+			MARK_PROPERTY_DIRTY_FROM_NAME(APickup, Item, this);
+		}
+	}
+}
+
+bool APickup::HasInteractors() const
+{
+	return InteractionComponent && InteractionComponent->HasInteractors();
+}
+
+float APickup::GetLastFocusTime() const
+{
+	return InteractionComponent ? InteractionComponent->GetLastFocusTime() : 0.f;
+}
+
+bool APickup::IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const
+{
+	return !bPooled && Super::IsNetRelevantFor(RealViewer, ViewTarget, SrcLocation);
+}
+
+void APickup::OnSerializeNewActor(FOutBunch& OutBunch)
+{
+	Super::OnSerializeNewActor(OutBunch);
+
+	/** The channel calls this before it replicates our properties, so the item goes out with the same update. Unlike relevancy,
+	 * this happens whether the legacy net driver or the replication graph decided we should replicate. */
+	EnsureItem();
+}
+
+void APickup::OnRep_Pooled()
+{
+	SetActorHiddenInGame(bPooled);
+	SetActorEnableCollision(!bPooled);
+
+	// Deactivating takes us out of the interaction subsystem, so nobody can focus us through a spatial query either
+	if (bPooled)
+	{
+		InteractionComponent->Deactivate();
+	}
+	else
+	{
+		InteractionComponent->Activate(true);
+	}
+}
+
 void APickup::OnRep_Item()
 {
 	if (Item)
@@ -10,6 +10,8 @@ UCLASS()
 class SURVIVALGAME_API APickup : public AActor
 {
 	GENERATED_BODY()
+
+	friend class UPickupSubsystem;
 	
 public:	
 	// Sets default values for this actor's properties
@@ -24,12 +26,44 @@ public:
 
 	UItem* GetItem() const { return Item; }
 
+	/** [server] Level placed pickups don't create their item until somebody could see or use it, as a big map would otherwise
+	 * create thousands of items at load for pickups nobody gets near for minutes. This creates it if it hasn't been yet. */
+	void EnsureItem();
+
+	// Whether we're a level placed pickup still waiting to create our item.
+	FORCEINLINE bool IsItemDeferred() const { return bItemDeferred; }
+
+	// [server] Called by UPickupSubsystem as the pickup goes into and comes out of its pool.
+	void SetPooled(const bool bNewPooled);
+
+	FORCEINLINE bool IsPooled() const { return bPooled; }
+
+	// [server] Whether we were promoted from a world item, so can be turned back into one. Cleared when we go into the pool.
+	FORCEINLINE bool IsPromotedWorldItem() const { return bPromotedWorldItem; }
+	FORCEINLINE void SetPromotedWorldItem(const bool bPromoted) { bPromotedWorldItem = bPromoted; }
+
+	// [server] World time a player last started or stopped focusing us.
+	float GetLastFocusTime() const;
+
+	/** Whether a player is looking at or taking us, in which case we shouldn't be merged or cleaned up from under them.
+	 * On the server this includes remote players focusing us, as their clients report it. */
+	bool HasInteractors() const;
+
+	virtual bool IsNetRelevantFor(const AActor* RealViewer, const AActor* ViewTarget, const FVector& SrcLocation) const override;
+
+	// [server] A connection is opening a channel for us, so we're about to replicate for the first time and need our item.
+	virtual void OnSerializeNewActor(class FOutBunch& OutBunch) override;
+
 protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
 	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
 	virtual bool ReplicateSubobjects(class UActorChannel* Channel, class FOutBunch* Bunch, FReplicationFlags* RepFlags);
 
+	UFUNCTION()
+	void OnPickupFocused(class ASurvivalCharacter* Character);
+
 #if WITH_EDITOR
 	virtual void PostEditChangeProperty(FPropertyChangedEvent& PropertyChangedEvent) override;
 #endif
@@ -41,6 +75,9 @@ protected:
 	UFUNCTION()
 	void OnRep_Item();
 
+	UFUNCTION()
+	void OnRep_Pooled();
+
 	/** If some property on the item is modified, we bind this to OnItemModified and refresh the UI if the item gets modified. */
 	UFUNCTION()
 	void OnItemModified();
@@ -58,4 +95,15 @@ private:
 
 	UPROPERTY(EditDefaultsOnly, BlueprintReadOnly, Category = Components, meta = (AllowPrivateAccess = true))
 	class UInteractionComponent* InteractionComponent;
+
+	// Replicated so clients also stop tracing against a pooled pickup in the moments before its channel closes.
+	UPROPERTY(ReplicatedUsing = OnRep_Pooled)
+	bool bPooled;
+
+	bool bItemDeferred;
+
+	bool bPromotedWorldItem;
+
+	// Where we are in UPickupSubsystem's list, so registering and unregistering don't have to search it. INDEX_NONE while unregistered.
+	int32 PickupIndex;
 };
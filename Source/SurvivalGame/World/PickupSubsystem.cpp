@@ -0,0 +1,530 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/PickupSubsystem.h"
+#include "SurvivalGame.h"
+#include "World/Pickup.h"
+#include "World/WorldItemChunk.h"
+#include "World/WorldItemSubsystem.h"
+#include "Engine/World.h"
+#include "Engine/NetDriver.h"
+#include "Engine/NetworkObjectList.h"
+
+DECLARE_CYCLE_STAT(TEXT("Count Pickup Dormancy"), STAT_CountPickupDormancy, STATGROUP_SurvivalGame);
+DECLARE_CYCLE_STAT(TEXT("Merge Pickups"), STAT_MergePickups, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickups Merged"), STAT_PickupsMerged, STATGROUP_SurvivalGame);
+DECLARE_CYCLE_STAT(TEXT("Clean Up Pickups"), STAT_CleanUpPickups, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickups Expired"), STAT_PickupsExpired, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("World Items Expired"), STAT_WorldItemsExpired, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickups Expiry Deferred"), STAT_PickupsExpiryDeferred, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pickups Scheduled To Expire"), STAT_PickupsScheduledToExpire, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickups Awake"), STAT_PickupsAwake, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickups Dormant"), STAT_PickupsDormant, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Pool Hits"), STAT_PickupPoolHits, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Pickup Pool Misses"), STAT_PickupPoolMisses, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Pooled Pickups"), STAT_PooledPickups, STATGROUP_SurvivalGame);
+
+UPickupSubsystem::UPickupSubsystem() :
+	MaxPooledPickupsPerClass(128), NumAwakePickups(0), NumDormantPickups(0), PoolHits(0), PoolMisses(0), NumPooledPickups(0),
+	MergeRadius(150.f), MergeInterval(2.f), MaxMergeChecksPerTick(32), MaxMergeTimeMs(0.25f), MergeBuildIndex(INDEX_NONE), LastMergePassTime(0.f), NumMergedPickups(0),
+	ExpiryRetryDelay(10.f), MaxCleanupsPerTick(16), MaxCleanupTimeMs(0.25f), NumExpiredPickups(0), NumExpiredWorldItems(0)
+{
+	PickupLifetimes.Add(EItemRarity::IR_COMMON, 300.f);
+	PickupLifetimes.Add(EItemRarity::IR_UNCOMMON, 600.f);
+	PickupLifetimes.Add(EItemRarity::IR_RARE, 1200.f);
+	PickupLifetimes.Add(EItemRarity::IR_VERYRARE, 1800.f);
+	PickupLifetimes.Add(EItemRarity::IR_LEGENDARY, 0.f);
+}
+
+void UPickupSubsystem::RegisterPickup(APickup* Pickup)
+{
+	if (Pickup && Pickup->PickupIndex == INDEX_NONE)
+	{
+		Pickup->PickupIndex = Pickups.Add(Pickup);
+	}
+}
+
+void UPickupSubsystem::UnregisterPickup(APickup* Pickup)
+{
+	if (!Pickup)
+	{
+		return;
+	}
+
+	// Swap the last pickup into our slot, so this doesn't have to search or shuffle the whole list when a level with thousands of pickups unloads
+	const int32 Index = Pickup->PickupIndex;
+	if (Pickups.IsValidIndex(Index) && Pickups[Index] == Pickup)
+	{
+		Pickups.RemoveAtSwap(Index, 1, false);
+
+		if (Pickups.IsValidIndex(Index) && Pickups[Index])
+		{
+			Pickups[Index]->PickupIndex = Index;
+		}
+	}
+	Pickup->PickupIndex = INDEX_NONE;
+
+	// The heap entry is left behind, and skipped once it comes up
+	if (ExpireTimes.Remove(Pickup) > 0)
+	{
+		DEC_DWORD_STAT(STAT_PickupsScheduledToExpire);
+	}
+}
+
+APickup* UPickupSubsystem::SpawnPickup(TSubclassOf<APickup> PickupClass, const FTransform& Transform, TSubclassOf<UItem> ItemClass, const int32 Quantity, AActor* Owner)
+{
+	if (!PickupClass)
+	{
+		return nullptr;
+	}
+
+	APickup* Pickup = TakeFromPool(PickupClass);
+
+	if (Pickup)
+	{
+		++PoolHits;
+		INC_DWORD_STAT(STAT_PickupPoolHits);
+
+		Pickup->SetOwner(Owner);
+		Pickup->SetActorTransform(Transform, false, nullptr, ETeleportType::ResetPhysics);
+		Pickup->SetPooled(false);
+		Pickup->AlignWithGround();
+
+		RegisterPickup(Pickup);
+	}
+	else
+	{
+		++PoolMisses;
+		INC_DWORD_STAT(STAT_PickupPoolMisses);
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.Owner = Owner;
+		SpawnParams.bNoFail = true;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AdjustIfPossibleButAlwaysSpawn;
+
+		Pickup = GetWorld()->SpawnActor<APickup>(PickupClass, Transform, SpawnParams);
+	}
+
+	if (Pickup)
+	{
+		Pickup->InitializePickup(ItemClass, Quantity);
+		ScheduleExpiry(Pickup);
+	}
+	return Pickup;
+}
+
+void UPickupSubsystem::ReleasePickup(APickup* Pickup)
+{
+	if (!Pickup || Pickup->IsPendingKillPending() || Pickup->IsPooled())
+	{
+		return;
+	}
+
+	// Level placed pickups are loaded by clients along with the map, so anyone joining later would still see a pooled one
+	FPickupPool& Pool = Pools.FindOrAdd(Pickup->GetClass());
+	if (Pickup->IsNetStartupActor() || Pool.Pickups.Num() >= MaxPooledPickupsPerClass)
+	{
+		Pickup->Destroy();
+		return;
+	}
+
+	UnregisterPickup(Pickup);
+	Pickup->SetPooled(true);
+
+	FPooledPickup& Pooled = Pool.Pickups.AddDefaulted_GetRef();
+	Pooled.Pickup = Pickup;
+	Pooled.ReleaseTime = GetWorld()->GetTimeSeconds();
+
+	++NumPooledPickups;
+	INC_DWORD_STAT(STAT_PooledPickups);
+}
+
+APickup* UPickupSubsystem::TakeFromPool(UClass* PickupClass)
+{
+	FPickupPool* Pool = Pools.Find(PickupClass);
+	if (!Pool)
+	{
+		return nullptr;
+	}
+
+	/** Clients only lose the pickup once the net driver closes its channel for not being relevant. Reusing it before then would
+	 * leave those clients with the old location, as pickups don't replicate movement. */
+	const UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	const float MinPooledTime = NetDriver ? NetDriver->RelevantTimeout + 1.f : 0.f;
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	while (Pool->Pickups.Num() > 0)
+	{
+		const FPooledPickup Pooled = Pool->Pickups[0];
+
+		if (Pooled.Pickup && !Pooled.Pickup->IsPendingKillPending() && TimeSeconds - Pooled.ReleaseTime < MinPooledTime)
+		{
+			// The rest went in after this one, so they aren't ready either
+			return nullptr;
+		}
+
+		Pool->Pickups.RemoveAt(0, 1, false);
+		--NumPooledPickups;
+		DEC_DWORD_STAT(STAT_PooledPickups);
+
+		if (Pooled.Pickup && !Pooled.Pickup->IsPendingKillPending())
+		{
+			return Pooled.Pickup;
+		}
+	}
+	return nullptr;
+}
+
+void UPickupSubsystem::Deinitialize()
+{
+	DEC_DWORD_STAT_BY(STAT_PooledPickups, NumPooledPickups);
+	DEC_DWORD_STAT_BY(STAT_PickupsScheduledToExpire, ExpireTimes.Num());
+
+	for (APickup* Pickup : Pickups)
+	{
+		if (Pickup)
+		{
+			Pickup->PickupIndex = INDEX_NONE;
+		}
+	}
+
+	Pickups.Empty();
+	Pools.Empty();
+	MergeQueue.Empty();
+	MergeCells.Empty();
+	MergeBuildIndex = INDEX_NONE;
+	ExpiryHeap.Empty();
+	ExpireTimes.Empty();
+	NumPooledPickups = 0;
+
+	Super::Deinitialize();
+}
+
+void UPickupSubsystem::Tick(float DeltaTime)
+{
+	TickMerging();
+	TickCleanup();
+
+#if STATS
+	// Walking every pickup isn't free, so only do it when someone is looking at the numbers
+	if (FThreadStats::IsCollectingData())
+	{
+		UpdateDormancyCounts();
+	}
+#endif
+}
+
+bool UPickupSubsystem::CanMerge(const APickup* Pickup) const
+{
+	const UItem* Item = Pickup ? Pickup->GetItem() : nullptr;
+	return Item && Item->GetIsStackable() && !Pickup->IsPooled() && !Pickup->IsPendingKillPending() && !Pickup->HasInteractors();
+}
+
+void UPickupSubsystem::BeginMergePass()
+{
+	MergeCells.Reset();
+	MergeQueue.Reset();
+	MergeBuildIndex = 0;
+}
+
+void UPickupSubsystem::TickMerging()
+{
+	if (MergeRadius <= 0.f || GetWorld()->GetNetMode() == NM_Client)
+	{
+		return;
+	}
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	if (MergeBuildIndex == INDEX_NONE && MergeQueue.Num() == 0)
+	{
+		if (TimeSeconds - LastMergePassTime < MergeInterval)
+		{
+			return;
+		}
+
+		BeginMergePass();
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_MergePickups);
+
+	const double EndTime = FPlatformTime::Seconds() + MaxMergeTimeMs / 1000.0;
+	int32 NumChecks = 0;
+
+	/** Sorting thousands of pickups into cells is a hitch of its own, so it shares the budget with the checks.
+	 * Pickups are swapped around as others unregister, so one moved mid-sort can be missed, it'll be picked up next pass. */
+	while (MergeBuildIndex != INDEX_NONE && NumChecks < MaxMergeChecksPerTick && (NumChecks == 0 || FPlatformTime::Seconds() < EndTime))
+	{
+		if (!Pickups.IsValidIndex(MergeBuildIndex))
+		{
+			MergeBuildIndex = INDEX_NONE;
+			break;
+		}
+
+		APickup* Pickup = Pickups[MergeBuildIndex++];
+		if (CanMerge(Pickup))
+		{
+			MergeCells.FindOrAdd(GetMergeCell(Pickup->GetActorLocation())).Add(Pickup);
+			MergeQueue.Add(Pickup);
+		}
+		++NumChecks;
+	}
+
+	if (MergeBuildIndex != INDEX_NONE)
+	{
+		return;
+	}
+
+	while (MergeQueue.Num() > 0 && NumChecks < MaxMergeChecksPerTick && (NumChecks == 0 || FPlatformTime::Seconds() < EndTime))
+	{
+		APickup* Pickup = MergeQueue.Pop(false).Get();
+
+		if (CanMerge(Pickup) && Pickup->GetItem()->GetQuantity() < Pickup->GetItem()->GetMaxStackSize())
+		{
+			MergeNearbyInto(Pickup);
+		}
+		++NumChecks;
+	}
+
+	// Everything's been checked, no need to hang on to the cells until the next pass
+	if (MergeQueue.Num() == 0)
+	{
+		MergeCells.Reset();
+		LastMergePassTime = TimeSeconds;
+	}
+}
+
+void UPickupSubsystem::MergeNearbyInto(APickup* Target)
+{
+	UItem* TargetItem = Target->GetItem();
+	const UClass* ItemClass = TargetItem->GetClass();
+	const FVector TargetLocation = Target->GetActorLocation();
+	const FIntVector TargetCell = GetMergeCell(TargetLocation);
+	const float MergeRadiusSq = FMath::Square(MergeRadius);
+
+	for (int32 X = -1; X <= 1; ++X)
+	{
+		for (int32 Y = -1; Y <= 1; ++Y)
+		{
+			for (int32 Z = -1; Z <= 1; ++Z)
+			{
+				TArray<TWeakObjectPtr<APickup>>* Cell = MergeCells.Find(TargetCell + FIntVector(X, Y, Z));
+				if (!Cell)
+				{
+					continue;
+				}
+
+				for (const TWeakObjectPtr<APickup>& OtherPtr : *Cell)
+				{
+					const int32 Space = TargetItem->GetMaxStackSize() - TargetItem->GetQuantity();
+					if (Space <= 0)
+					{
+						return;
+					}
+
+					APickup* Other = OtherPtr.Get();
+					if (Other == Target || !CanMerge(Other) || Other->GetItem()->GetClass() != ItemClass
+						|| FVector::DistSquared(Other->GetActorLocation(), TargetLocation) > MergeRadiusSq)
+					{
+						continue;
+					}
+
+					UItem* OtherItem = Other->GetItem();
+					const int32 Moved = FMath::Min(Space, OtherItem->GetQuantity());
+
+					TargetItem->SetQuantity(TargetItem->GetQuantity() + Moved);
+
+					if (Moved >= OtherItem->GetQuantity())
+					{
+						ReleasePickup(Other);
+
+						++NumMergedPickups;
+						INC_DWORD_STAT(STAT_PickupsMerged);
+					}
+					else
+					{
+						OtherItem->SetQuantity(OtherItem->GetQuantity() - Moved);
+					}
+				}
+			}
+		}
+	}
+}
+
+FIntVector UPickupSubsystem::GetMergeCell(const FVector& Location) const
+{
+	return FIntVector(FMath::FloorToInt(Location.X / MergeRadius), FMath::FloorToInt(Location.Y / MergeRadius), FMath::FloorToInt(Location.Z / MergeRadius));
+}
+
+void UPickupSubsystem::ScheduleExpiry(APickup* Pickup)
+{
+	const UItem* Item = Pickup ? Pickup->GetItem() : nullptr;
+	if (!Item || Pickup->IsNetStartupActor())
+	{
+		return;
+	}
+
+	const float Lifetime = PickupLifetimes.FindRef(Item->GetRarity());
+	if (Lifetime <= 0.f)
+	{
+		return;
+	}
+
+	const float ExpireTime = GetWorld()->GetTimeSeconds() + Lifetime;
+
+	if (!ExpireTimes.Contains(Pickup))
+	{
+		INC_DWORD_STAT(STAT_PickupsScheduledToExpire);
+	}
+	ExpireTimes.Add(Pickup, ExpireTime);
+	ExpiryHeap.HeapPush(FPickupExpiry{ Pickup, ExpireTime });
+}
+
+void UPickupSubsystem::ScheduleWorldItemExpiry(AWorldItemChunk* Chunk, const int32 RecordId, const float ExpireTime)
+{
+	if (Chunk && ExpireTime > 0.f)
+	{
+		FPickupExpiry Expiry;
+		Expiry.ExpireTime = ExpireTime;
+		Expiry.Chunk = Chunk;
+		Expiry.RecordId = RecordId;
+		ExpiryHeap.HeapPush(Expiry);
+	}
+}
+
+void UPickupSubsystem::TickCleanup()
+{
+	if (ExpiryHeap.Num() == 0)
+	{
+		return;
+	}
+
+	const float TimeSeconds = GetWorld()->GetTimeSeconds();
+
+	// Nothing's due yet, which is nearly every tick
+	if (ExpiryHeap.HeapTop().ExpireTime > TimeSeconds)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_CleanUpPickups);
+
+	const double EndTime = FPlatformTime::Seconds() + MaxCleanupTimeMs / 1000.0;
+	int32 NumCleanups = 0;
+
+	while (ExpiryHeap.Num() > 0 && ExpiryHeap.HeapTop().ExpireTime <= TimeSeconds && NumCleanups < MaxCleanupsPerTick && FPlatformTime::Seconds() < EndTime)
+	{
+		FPickupExpiry Expiry;
+		ExpiryHeap.HeapPop(Expiry, false);
+
+		if (Expiry.RecordId != INDEX_NONE)
+		{
+			if (CleanUpWorldItem(Expiry))
+			{
+				++NumCleanups;
+			}
+			continue;
+		}
+
+		// Stale entry, the pickup has gone or has been given a new lifetime since
+		APickup* Pickup = Expiry.Pickup.Get();
+		const float* ScheduledTime = Pickup ? ExpireTimes.Find(Pickup) : nullptr;
+		if (!ScheduledTime || *ScheduledTime != Expiry.ExpireTime)
+		{
+			continue;
+		}
+
+		// Don't take it out from under a player who's looking at it or taking it
+		if (Pickup->HasInteractors())
+		{
+			const float RetryTime = TimeSeconds + FMath::Max(ExpiryRetryDelay, 1.f);
+			ExpireTimes.Add(Pickup, RetryTime);
+			ExpiryHeap.HeapPush(FPickupExpiry{ Pickup, RetryTime });
+
+			INC_DWORD_STAT(STAT_PickupsExpiryDeferred);
+			continue;
+		}
+
+		ReleasePickup(Pickup);
+
+		++NumCleanups;
+		++NumExpiredPickups;
+		INC_DWORD_STAT(STAT_PickupsExpired);
+	}
+}
+
+bool UPickupSubsystem::CleanUpWorldItem(const FPickupExpiry& Expiry)
+{
+	// Stale entry, the record has been promoted or demoted again, or its chunk has gone since
+	AWorldItemChunk* Chunk = Expiry.Chunk.Get();
+	const FWorldItemRecord* Record = Chunk ? Chunk->FindRecord(Expiry.RecordId) : nullptr;
+	if (!Record || Record->ExpireTime != Expiry.ExpireTime)
+	{
+		return false;
+	}
+
+	UWorldItemSubsystem* WorldItems = GetWorld()->GetSubsystem<UWorldItemSubsystem>();
+	if (!WorldItems || !WorldItems->RemoveWorldItem(Chunk, Expiry.RecordId))
+	{
+		return false;
+	}
+
+	++NumExpiredWorldItems;
+	INC_DWORD_STAT(STAT_WorldItemsExpired);
+	return true;
+}
+
+void UPickupSubsystem::UpdateDormancyCounts()
+{
+	SCOPE_CYCLE_COUNTER(STAT_CountPickupDormancy);
+
+	NumAwakePickups = 0;
+	NumDormantPickups = 0;
+
+	UNetDriver* NetDriver = GetWorld()->GetNetDriver();
+	const int32 NumConnections = NetDriver ? NetDriver->ClientConnections.Num() : 0;
+
+	for (const APickup* Pickup : Pickups)
+	{
+		if (!Pickup)
+		{
+			continue;
+		}
+
+		const FNetworkObjectInfo* Info = NetDriver ? NetDriver->FindNetworkObjectInfo(Pickup) : nullptr;
+
+		if (Info && NumConnections > 0 && Info->DormantConnections.Num() >= NumConnections)
+		{
+			++NumDormantPickups;
+		}
+		else
+		{
+			++NumAwakePickups;
+		}
+	}
+
+	INC_DWORD_STAT_BY(STAT_PickupsAwake, NumAwakePickups);
+	INC_DWORD_STAT_BY(STAT_PickupsDormant, NumDormantPickups);
+}
+
+bool UPickupSubsystem::IsTickable() const
+{
+	// World items can be waiting to expire even when there are no pickups
+	return Pickups.Num() > 0 || ExpiryHeap.Num() > 0;
+}
+
+ETickableTickType UPickupSubsystem::GetTickableTickType() const
+{
+	// The class default object gets constructed like any other, but shouldn't tick
+	return IsTemplate() ? ETickableTickType::Never : ETickableTickType::Conditional;
+}
+
+UWorld* UPickupSubsystem::GetTickableGameObjectWorld() const
+{
+	return GetWorld();
+}
+
+TStatId UPickupSubsystem::GetStatId() const
+{
+	RETURN_QUICK_DECLARE_CYCLE_STAT(UPickupSubsystem, STATGROUP_Tickables);
+}
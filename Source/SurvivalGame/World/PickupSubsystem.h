@@ -0,0 +1,200 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Tickable.h"
+#include "Items/Item.h"
+#include "PickupSubsystem.generated.h"
+
+class APickup;
+class AWorldItemChunk;
+
+// A pickup waiting in the pool, and when it went in.
+USTRUCT()
+struct FPooledPickup
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	APickup* Pickup = nullptr;
+
+	float ReleaseTime = 0.f;
+};
+
+// All of the pooled pickups of one class, oldest first.
+USTRUCT()
+struct FPickupPool
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	TArray<FPooledPickup> Pickups;
+};
+
+// When a dropped pickup, or a world item record if Chunk is set, is due to be cleaned up. Kept in a heap, soonest first.
+struct FPickupExpiry
+{
+	TWeakObjectPtr<APickup> Pickup;
+	float ExpireTime;
+
+	TWeakObjectPtr<AWorldItemChunk> Chunk;
+	int32 RecordId = INDEX_NONE;
+
+	FORCEINLINE bool operator<(const FPickupExpiry& Other) const { return ExpireTime < Other.ExpireTime; }
+};
+
+/**
+ * [server] Keeps track of every pickup in the world. Pickups are dormant on the network unless their item changes,
+ * so this is also where we count how many of them the net driver still has to consider.
+ *
+ * Also pools pickup actors, so dumping an inventory or dying doesn't mean spawning and destroying a pile of actors.
+ * Pooled pickups are hidden, have no collision and aren't relevant to anyone.
+ *
+ * Every so often, nearby pickups of the same item class are merged into as few stacks as possible. The pass is spread
+ * over several ticks, each of which only checks a handful of pickups.
+ *
+ * Dropped pickups also expire after a lifetime that depends on their item's rarity, so long running servers don't pile them up.
+ * Level placed pickups never expire. World item records get the same lifetimes, and are cleaned up here too, see UWorldItemSubsystem.
+ */
+UCLASS(Config = Game)
+class SURVIVALGAME_API UPickupSubsystem : public UWorldSubsystem, public FTickableGameObject
+{
+	GENERATED_BODY()
+
+public:
+	UPickupSubsystem();
+
+	void RegisterPickup(APickup* Pickup);
+	void UnregisterPickup(APickup* Pickup);
+
+	// Takes a pickup of this class out of the pool, or spawns one if there's none ready, and initializes it with the item.
+	APickup* SpawnPickup(TSubclassOf<APickup> PickupClass, const FTransform& Transform, TSubclassOf<UItem> ItemClass, const int32 Quantity, AActor* Owner = nullptr);
+
+	// Use this instead of destroying a pickup. Puts it in the pool, or destroys it if the pool is full.
+	void ReleasePickup(APickup* Pickup);
+
+	// How many seconds dropped items of this rarity last. Zero means they never expire.
+	FORCEINLINE float GetPickupLifetime(const EItemRarity Rarity) const { return PickupLifetimes.FindRef(Rarity); }
+
+	// Clean up this world item record at ExpireTime, unless it's gone by then. ExpireTime has to match the record's.
+	void ScheduleWorldItemExpiry(AWorldItemChunk* Chunk, const int32 RecordId, const float ExpireTime);
+
+	FORCEINLINE int32 GetPoolHits() const { return PoolHits; }
+	FORCEINLINE int32 GetPoolMisses() const { return PoolMisses; }
+	FORCEINLINE int32 GetNumPooledPickups() const { return NumPooledPickups; }
+	FORCEINLINE int32 GetNumMergedPickups() const { return NumMergedPickups; }
+	FORCEINLINE int32 GetNumExpiredPickups() const { return NumExpiredPickups; }
+	FORCEINLINE int32 GetNumExpiredWorldItems() const { return NumExpiredWorldItems; }
+
+	FORCEINLINE int32 GetNumPickups() const { return Pickups.Num(); }
+
+	// Counted every tick while stats are being collected, see UpdateDormancyCounts().
+	FORCEINLINE int32 GetNumAwakePickups() const { return NumAwakePickups; }
+	FORCEINLINE int32 GetNumDormantPickups() const { return NumDormantPickups; }
+
+	virtual void Deinitialize() override;
+
+	// FTickableGameObject
+	virtual void Tick(float DeltaTime) override;
+	virtual bool IsTickable() const override;
+	virtual ETickableTickType GetTickableTickType() const override;
+	virtual UWorld* GetTickableGameObjectWorld() const override;
+	virtual TStatId GetStatId() const override;
+
+private:
+	// Pops the oldest pooled pickup of this class, if it has been in the pool long enough to be reused.
+	APickup* TakeFromPool(UClass* PickupClass);
+
+	// Whether the pickup can take part in merging, either as the stack being topped up or the one being taken from.
+	bool CanMerge(const APickup* Pickup) const;
+
+	// Start sorting the mergeable pickups into cells. This is done a slice at a time by TickMerging(), same as the checks.
+	void BeginMergePass();
+
+	// Sorts pickups into cells, then once they're all in, checks queued pickups. Stops when we run out of checks or time for this tick.
+	void TickMerging();
+
+	// Tops Target's stack up from other pickups of the same item class within MergeRadius.
+	void MergeNearbyInto(APickup* Target);
+
+	FIntVector GetMergeCell(const FVector& Location) const;
+
+	// Starts the pickup's lifetime, going by its item's rarity. Does nothing if that rarity never expires.
+	void ScheduleExpiry(APickup* Pickup);
+
+	// Cleans up expired pickups and world items, until we run out of cleanups or time for this tick.
+	void TickCleanup();
+
+	// Removes the entry's world item record if it's still there with the same lifetime. Returns whether it did.
+	bool CleanUpWorldItem(const FPickupExpiry& Expiry);
+
+	// A pickup counts as dormant once it is dormant on every client connection, as that's when the net driver stops looking at it.
+	void UpdateDormancyCounts();
+
+	UPROPERTY()
+	TArray<APickup*> Pickups;
+
+	UPROPERTY()
+	TMap<UClass*, FPickupPool> Pools;
+
+	// How many pickups of one class we keep around at most.
+	UPROPERTY(Config)
+	int32 MaxPooledPickupsPerClass;
+
+	int32 NumAwakePickups;
+	int32 NumDormantPickups;
+
+	int32 PoolHits;
+	int32 PoolMisses;
+	int32 NumPooledPickups;
+
+	// Pickups within this many cm of each other get merged if they hold the same item class. Zero turns merging off.
+	UPROPERTY(Config)
+	float MergeRadius;
+
+	// Seconds between the end of one merge pass and the start of the next.
+	UPROPERTY(Config)
+	float MergeInterval;
+
+	// Limits on how much of a merge pass can run in one tick.
+	UPROPERTY(Config)
+	int32 MaxMergeChecksPerTick;
+
+	UPROPERTY(Config)
+	float MaxMergeTimeMs;
+
+	// Pickups still to check in the current pass, and where they all were when they were sorted. Cells are MergeRadius wide.
+	TArray<TWeakObjectPtr<APickup>> MergeQueue;
+	TMap<FIntVector, TArray<TWeakObjectPtr<APickup>>> MergeCells;
+
+	// The next pickup to sort into a cell, or INDEX_NONE once the current pass is done sorting.
+	int32 MergeBuildIndex;
+
+	float LastMergePassTime;
+	int32 NumMergedPickups;
+
+	// How many seconds a dropped pickup lasts, by item rarity. Zero or missing means it never expires.
+	UPROPERTY(Config)
+	TMap<EItemRarity, float> PickupLifetimes;
+
+	// If an expired pickup is in use, we check again after this many seconds.
+	UPROPERTY(Config)
+	float ExpiryRetryDelay;
+
+	// Limits on how many pickups can be cleaned up in one tick.
+	UPROPERTY(Config)
+	int32 MaxCleanupsPerTick;
+
+	UPROPERTY(Config)
+	float MaxCleanupTimeMs;
+
+	// Pickups with a lifetime, and when they expire. The heap can hold stale entries for pickups that have since been pooled or rescheduled,
+	// so an entry only counts if it matches what's in ExpireTimes. World item entries are checked against their record's ExpireTime instead.
+	TArray<FPickupExpiry> ExpiryHeap;
+	TMap<TWeakObjectPtr<APickup>, float> ExpireTimes;
+
+	int32 NumExpiredPickups;
+	int32 NumExpiredWorldItems;
+};
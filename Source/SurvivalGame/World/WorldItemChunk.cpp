@@ -0,0 +1,174 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/WorldItemChunk.h"
+#include "World/WorldItemSubsystem.h"
+#include "Items/Item.h"
+#include "Components/InstancedStaticMeshComponent.h"
+#include "Net/UnrealNetwork.h"
+
+AWorldItemChunk::AWorldItemChunk() :
+	NextRecordId(0), bInstancesDirty(false)
+{
+	PrimaryActorTick.bCanEverTick = false;
+
+	SetRootComponent(CreateDefaultSubobject<USceneComponent>(FName(TEXT("Root"))));
+
+	Records.OwnerChunk = this;
+
+	bReplicates = true;
+}
+
+int32 AWorldItemChunk::AddRecord(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FTransform& Transform, const float ExpireTime)
+{
+	FWorldItemRecord& Record = Records.Records.AddDefaulted_GetRef();
+	Record.RecordId = NextRecordId++;
+	Record.ItemClass = ItemClass;
+	Record.Quantity = Quantity;
+	Record.Location = Transform.GetLocation();
+	Record.Rotation = Transform.Rotator();
+	Record.ExpireTime = ExpireTime;
+
+	Records.MarkItemDirty(Record);
+	MarkInstancesDirty();
+
+	return Record.RecordId;
+}
+
+bool AWorldItemChunk::RemoveRecord(const int32 RecordId, FWorldItemRecord* OutRemovedRecord)
+{
+	const int32 Index = Records.Records.IndexOfByPredicate([RecordId](const FWorldItemRecord& Record) { return Record.RecordId == RecordId; });
+	if (Index == INDEX_NONE)
+	{
+		return false;
+	}
+
+	if (OutRemovedRecord)
+	{
+		*OutRemovedRecord = Records.Records[Index];
+	}
+
+	Records.Records.RemoveAtSwap(Index, 1, false);
+	Records.MarkArrayDirty();
+	MarkInstancesDirty();
+
+	return true;
+}
+
+const FWorldItemRecord* AWorldItemChunk::FindRecord(const int32 RecordId) const
+{
+	return Records.Records.FindByPredicate([RecordId](const FWorldItemRecord& Record) { return Record.RecordId == RecordId; });
+}
+
+int32 AWorldItemChunk::GetRecordIdForInstance(const UPrimitiveComponent* Component, const int32 InstanceIndex) const
+{
+	for (const TPair<UStaticMesh*, FWorldItemMeshInstances>& Pair : MeshInstances)
+	{
+		if (Pair.Value.Component == Component)
+		{
+			return Pair.Value.RecordIds.IsValidIndex(InstanceIndex) ? Pair.Value.RecordIds[InstanceIndex] : INDEX_NONE;
+		}
+	}
+	return INDEX_NONE;
+}
+
+void AWorldItemChunk::MarkInstancesDirty()
+{
+	if (bInstancesDirty || GetNetMode() == NM_DedicatedServer)
+	{
+		return;
+	}
+
+	bInstancesDirty = true;
+
+	if (UWorld* World = GetWorld())
+	{
+		World->GetTimerManager().SetTimerForNextTick(this, &AWorldItemChunk::RebuildInstances);
+	}
+}
+
+void AWorldItemChunk::BeginPlay()
+{
+	Super::BeginPlay();
+
+	if (UWorldItemSubsystem* WorldItems = GetWorld()->GetSubsystem<UWorldItemSubsystem>())
+	{
+		WorldItems->RegisterChunk(this);
+	}
+}
+
+void AWorldItemChunk::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	if (UWorldItemSubsystem* WorldItems = GetWorld()->GetSubsystem<UWorldItemSubsystem>())
+	{
+		WorldItems->UnregisterChunk(this);
+	}
+
+	Super::EndPlay(EndPlayReason);
+}
+
+void AWorldItemChunk::GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const
+{
+	Super::GetLifetimeReplicatedProps(OutLifetimeProps);
+
+	DOREPLIFETIME(AWorldItemChunk, Records);
+}
+
+void AWorldItemChunk::RebuildInstances()
+{
+	bInstancesDirty = false;
+
+	// Chunks hold a modest number of items, so rebuilding everything is simpler than patching instance indices and fast enough
+	for (TPair<UStaticMesh*, FWorldItemMeshInstances>& Pair : MeshInstances)
+	{
+		Pair.Value.Component->ClearInstances();
+		Pair.Value.RecordIds.Reset();
+	}
+
+	for (const FWorldItemRecord& Record : Records.Records)
+	{
+		const UItem* ItemDefaults = Record.ItemClass ? GetDefault<UItem>(Record.ItemClass) : nullptr;
+		UStaticMesh* PickupMesh = ItemDefaults ? ItemDefaults->GetPickupMesh() : nullptr;
+		if (!PickupMesh)
+		{
+			continue;
+		}
+
+		FWorldItemMeshInstances& Instances = MeshInstances.FindOrAdd(PickupMesh);
+		if (!Instances.Component)
+		{
+			Instances.Component = NewObject<UInstancedStaticMeshComponent>(this);
+			Instances.Component->SetStaticMesh(PickupMesh);
+			Instances.Component->SetCollisionResponseToChannel(ECC_Pawn, ECR_Ignore);	// same as pickups
+			Instances.Component->SetupAttachment(GetRootComponent());
+			Instances.Component->RegisterComponent();
+		}
+
+		Instances.Component->AddInstanceWorldSpace(Record.GetTransform());
+		Instances.RecordIds.Add(Record.RecordId);
+	}
+}
+
+void FWorldItemRecord::PreReplicatedRemove(const FWorldItemRecordArray& InArraySerializer)
+{
+	if (InArraySerializer.OwnerChunk)
+	{
+		InArraySerializer.OwnerChunk->MarkInstancesDirty();
+	}
+}
+
+void FWorldItemRecord::PostReplicatedAdd(const FWorldItemRecordArray& InArraySerializer)
+{
+	if (InArraySerializer.OwnerChunk)
+	{
+		InArraySerializer.OwnerChunk->MarkInstancesDirty();
+	}
+}
+
+void FWorldItemRecord::PostReplicatedChange(const FWorldItemRecordArray& InArraySerializer)
+{
+	if (InArraySerializer.OwnerChunk)
+	{
+		InArraySerializer.OwnerChunk->MarkInstancesDirty();
+	}
+}
@@ -0,0 +1,142 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+#include "Engine/NetSerialization.h"
+#include "WorldItemChunk.generated.h"
+
+class UItem;
+class AWorldItemChunk;
+class UInstancedStaticMeshComponent;
+
+/** An item lying in the world, without a pickup actor of its own. */
+USTRUCT()
+struct FWorldItemRecord : public FFastArraySerializerItem
+{
+	GENERATED_BODY()
+
+public:
+	FWorldItemRecord() : RecordId(INDEX_NONE), Quantity(0), ExpireTime(0.f) {};
+
+	FORCEINLINE FTransform GetTransform() const { return FTransform(Rotation, Location); }
+
+	// [client] Fast array callbacks, these tell the chunk to update its instances.
+	void PreReplicatedRemove(const struct FWorldItemRecordArray& InArraySerializer);
+	void PostReplicatedAdd(const struct FWorldItemRecordArray& InArraySerializer);
+	void PostReplicatedChange(const struct FWorldItemRecordArray& InArraySerializer);
+
+public:
+	// Unique within the chunk, so clients can tell the server which item they mean.
+	UPROPERTY()
+	int32 RecordId;
+
+	UPROPERTY()
+	TSubclassOf<UItem> ItemClass;
+
+	UPROPERTY()
+	int32 Quantity;
+
+	UPROPERTY()
+	FVector_NetQuantize10 Location;
+
+	UPROPERTY()
+	FRotator Rotation;
+
+	// [server] World time the item gets cleaned up at, see UPickupSubsystem. Zero means never. Clients don't need it, so it isn't replicated.
+	float ExpireTime;
+};
+
+USTRUCT()
+struct FWorldItemRecordArray : public FFastArraySerializer
+{
+	GENERATED_BODY()
+
+public:
+	FWorldItemRecordArray() : OwnerChunk(nullptr) {};
+
+	bool NetDeltaSerialize(FNetDeltaSerializeInfo& DeltaParms)
+	{
+		return FFastArraySerializer::FastArrayDeltaSerialize<FWorldItemRecord, FWorldItemRecordArray>(Records, DeltaParms, *this);
+	}
+
+public:
+	UPROPERTY()
+	TArray<FWorldItemRecord> Records;
+
+	// Set in AWorldItemChunk's constructor, see FInventoryItemArray.
+	AWorldItemChunk* OwnerChunk;
+};
+
+template<>
+struct TStructOpsTypeTraits<FWorldItemRecordArray> : public TStructOpsTypeTraitsBase2<FWorldItemRecordArray>
+{
+	enum
+	{
+		WithNetDeltaSerializer = true,
+	};
+};
+
+// One instanced mesh component, and which record each of its instances is.
+USTRUCT()
+struct FWorldItemMeshInstances
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	UInstancedStaticMeshComponent* Component = nullptr;
+
+	TArray<int32> RecordIds;
+};
+
+/**
+ * Holds the loose items in one cell of the world, spawned and managed by UWorldItemSubsystem.
+ * Items are replicated as a fast array of records and drawn with one instanced static mesh per pickup mesh,
+ * so a pile of loot costs one actor per chunk instead of one actor, a few components and an item object per item.
+ */
+UCLASS(NotPlaceable, NotBlueprintable)
+class SURVIVALGAME_API AWorldItemChunk : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	AWorldItemChunk();
+
+	// [server] Returns the new record's id.
+	int32 AddRecord(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FTransform& Transform, const float ExpireTime = 0.f);
+
+	// [server] Returns false if there is no such record.
+	bool RemoveRecord(const int32 RecordId, FWorldItemRecord* OutRemovedRecord = nullptr);
+
+	const FWorldItemRecord* FindRecord(const int32 RecordId) const;
+
+	// Which record a mesh instance belongs to, e.g. the one an interaction trace hit. INDEX_NONE if the component isn't one of ours.
+	int32 GetRecordIdForInstance(const UPrimitiveComponent* Component, const int32 InstanceIndex) const;
+
+	FORCEINLINE int32 GetNumRecords() const { return Records.Records.Num(); }
+
+	// Rebuild the mesh instances on the next tick. Changes usually come in bursts, so this avoids rebuilding more than once a frame.
+	void MarkInstancesDirty();
+
+	UPROPERTY()
+	FIntPoint ChunkCoord;
+
+protected:
+	virtual void BeginPlay() override;
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+	virtual void GetLifetimeReplicatedProps(TArray<FLifetimeProperty>& OutLifetimeProps) const override;
+
+private:
+	void RebuildInstances();
+
+	UPROPERTY(Replicated)
+	FWorldItemRecordArray Records;
+
+	// Keyed by pickup mesh.
+	UPROPERTY(Transient)
+	TMap<UStaticMesh*, FWorldItemMeshInstances> MeshInstances;
+
+	int32 NextRecordId;
+	bool bInstancesDirty;
+};
@@ -0,0 +1,211 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "World/WorldItemSubsystem.h"
+#include "SurvivalGame.h"
+#include "World/WorldItemChunk.h"
+#include "World/Pickup.h"
+#include "World/PickupSubsystem.h"
+#include "Items/Item.h"
+#include "Engine/World.h"
+#include "TimerManager.h"
+
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("World Items"), STAT_WorldItems, STATGROUP_SurvivalGame);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("World Item Chunks"), STAT_WorldItemChunks, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("World Items Promoted"), STAT_WorldItemsPromoted, STATGROUP_SurvivalGame);
+DECLARE_DWORD_COUNTER_STAT(TEXT("World Items Demoted"), STAT_WorldItemsDemoted, STATGROUP_SurvivalGame);
+
+UWorldItemSubsystem::UWorldItemSubsystem() :
+	NumWorldItems(0), ChunkSize(5000.f), DemoteDelay(30.f), DemoteCheckInterval(5.f)
+{
+
+}
+
+bool UWorldItemSubsystem::AddWorldItem(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FTransform& Transform)
+{
+	UWorld* World = GetWorld();
+	if (!World || World->GetNetMode() == NM_Client || !ItemClass || Quantity <= 0)
+	{
+		return false;
+	}
+
+	const FIntPoint ChunkCoord = GetChunkCoord(Transform.GetLocation());
+
+	AWorldItemChunk* Chunk = Chunks.FindRef(ChunkCoord);
+	if (!Chunk)
+	{
+		// Put the chunk in the middle of its cell, so relevancy is measured from there
+		const FVector ChunkLocation((ChunkCoord.X + 0.5f) * ChunkSize, (ChunkCoord.Y + 0.5f) * ChunkSize, Transform.GetLocation().Z);
+
+		FActorSpawnParameters SpawnParams;
+		SpawnParams.SpawnCollisionHandlingOverride = ESpawnActorCollisionHandlingMethod::AlwaysSpawn;
+
+		// Registers itself from BeginPlay, which SpawnActor runs for us
+		Chunk = World->SpawnActor<AWorldItemChunk>(AWorldItemChunk::StaticClass(), FTransform(ChunkLocation), SpawnParams);
+		if (!Chunk)
+		{
+			return false;
+		}
+	}
+
+	// Same lifetime as a dropped pickup of the item would get
+	UPickupSubsystem* PickupSubsystem = World->GetSubsystem<UPickupSubsystem>();
+	const float Lifetime = PickupSubsystem ? PickupSubsystem->GetPickupLifetime(GetDefault<UItem>(ItemClass)->GetRarity()) : 0.f;
+	const float ExpireTime = Lifetime > 0.f ? World->GetTimeSeconds() + Lifetime : 0.f;
+
+	const int32 RecordId = Chunk->AddRecord(ItemClass, Quantity, Transform, ExpireTime);
+
+	if (ExpireTime > 0.f)
+	{
+		PickupSubsystem->ScheduleWorldItemExpiry(Chunk, RecordId, ExpireTime);
+	}
+
+	++NumWorldItems;
+	INC_DWORD_STAT(STAT_WorldItems);
+
+	return true;
+}
+
+APickup* UWorldItemSubsystem::PromoteToPickup(AWorldItemChunk* Chunk, const int32 RecordId, TSubclassOf<APickup> PickupClass)
+{
+	UWorld* World = GetWorld();
+	if (!World || !Chunk || !PickupClass)
+	{
+		return nullptr;
+	}
+
+	FWorldItemRecord Record;
+	if (!RemoveWorldItem(Chunk, RecordId, &Record))
+	{
+		return nullptr;
+	}
+
+	INC_DWORD_STAT(STAT_WorldItemsPromoted);
+
+	APickup* Pickup = nullptr;
+	if (UPickupSubsystem* PickupSubsystem = World->GetSubsystem<UPickupSubsystem>())
+	{
+		Pickup = PickupSubsystem->SpawnPickup(PickupClass, Record.GetTransform(), Record.ItemClass, Record.Quantity);
+	}
+
+	if (Pickup && DemoteDelay > 0.f)
+	{
+		Pickup->SetPromotedWorldItem(true);
+		PromotedPickups.Add({ Pickup, World->GetTimeSeconds() });
+
+		if (!World->GetTimerManager().IsTimerActive(DemoteTimerHandle))
+		{
+			World->GetTimerManager().SetTimer(DemoteTimerHandle, this, &UWorldItemSubsystem::DemotePickups, FMath::Max(DemoteCheckInterval, 0.1f), true);
+		}
+	}
+
+	return Pickup;
+}
+
+bool UWorldItemSubsystem::RemoveWorldItem(AWorldItemChunk* Chunk, const int32 RecordId, FWorldItemRecord* OutRemovedRecord)
+{
+	if (!Chunk || !Chunk->RemoveRecord(RecordId, OutRemovedRecord))
+	{
+		return false;
+	}
+
+	--NumWorldItems;
+	DEC_DWORD_STAT(STAT_WorldItems);
+
+	// Don't leave empty chunk actors lying around for the net driver to consider
+	if (Chunk->GetNumRecords() == 0)
+	{
+		Chunk->Destroy();
+	}
+
+	return true;
+}
+
+void UWorldItemSubsystem::DemotePickups()
+{
+	UWorld* World = GetWorld();
+	UPickupSubsystem* PickupSubsystem = World ? World->GetSubsystem<UPickupSubsystem>() : nullptr;
+	if (!PickupSubsystem)
+	{
+		return;
+	}
+
+	const float TimeSeconds = World->GetTimeSeconds();
+
+	for (int32 i = PromotedPickups.Num() - 1; i >= 0; --i)
+	{
+		const FPromotedPickup& Promoted = PromotedPickups[i];
+		APickup* Pickup = Promoted.Pickup.Get();
+
+		// Taken, merged away or pooled since. A pooled pickup may already be back out as something else, so the pool clears the flag.
+		if (!Pickup || Pickup->IsPendingKillPending() || !Pickup->IsPromotedWorldItem())
+		{
+			PromotedPickups.RemoveAtSwap(i, 1, false);
+			continue;
+		}
+
+		if (Pickup->HasInteractors() || TimeSeconds - FMath::Max(Promoted.PromoteTime, Pickup->GetLastFocusTime()) < DemoteDelay)
+		{
+			continue;
+		}
+
+		UItem* Item = Pickup->GetItem();
+		if (Item && AddWorldItem(Item->GetClass(), Item->GetQuantity(), Pickup->GetActorTransform()))
+		{
+			INC_DWORD_STAT(STAT_WorldItemsDemoted);
+			PickupSubsystem->ReleasePickup(Pickup);
+		}
+
+		PromotedPickups.RemoveAtSwap(i, 1, false);
+	}
+
+	if (PromotedPickups.Num() == 0)
+	{
+		World->GetTimerManager().ClearTimer(DemoteTimerHandle);
+	}
+}
+
+void UWorldItemSubsystem::RegisterChunk(AWorldItemChunk* Chunk)
+{
+	// Chunks sit in the middle of their cell, so the coordinate comes from where they are. Clients don't get it any other way,
+	// and on the server BeginPlay runs inside SpawnActor, before AddWorldItem could set it.
+	Chunk->ChunkCoord = GetChunkCoord(Chunk->GetActorLocation());
+
+	if (!Chunks.Contains(Chunk->ChunkCoord))
+	{
+		Chunks.Add(Chunk->ChunkCoord, Chunk);
+		INC_DWORD_STAT(STAT_WorldItemChunks);
+	}
+}
+
+void UWorldItemSubsystem::UnregisterChunk(AWorldItemChunk* Chunk)
+{
+	if (Chunks.FindRef(Chunk->ChunkCoord) == Chunk)
+	{
+		Chunks.Remove(Chunk->ChunkCoord);
+		DEC_DWORD_STAT(STAT_WorldItemChunks);
+	}
+}
+
+bool UWorldItemSubsystem::HasChunkNear(const FVector& Location, const float Radius) const
+{
+	const FIntPoint Min = GetChunkCoord(Location - FVector(Radius));
+	const FIntPoint Max = GetChunkCoord(Location + FVector(Radius));
+
+	for (int32 X = Min.X; X <= Max.X; ++X)
+	{
+		for (int32 Y = Min.Y; Y <= Max.Y; ++Y)
+		{
+			if (Chunks.Contains(FIntPoint(X, Y)))
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+FIntPoint UWorldItemSubsystem::GetChunkCoord(const FVector& Location) const
+{
+	return FIntPoint(FMath::FloorToInt(Location.X / ChunkSize), FMath::FloorToInt(Location.Y / ChunkSize));
+}
@@ -0,0 +1,83 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "WorldItemSubsystem.generated.h"
+
+class UItem;
+class APickup;
+class AWorldItemChunk;
+struct FWorldItemRecord;
+
+/**
+ * Keeps loose items in the world as records in AWorldItemChunk actors instead of as APickup actors.
+ * The world is split into square chunks, each with its own replicated actor, so net relevancy still works per area.
+ * A real pickup is only spawned once a player focuses an item, see ASurvivalCharacter::ServerPromoteWorldItem(),
+ * and it goes back to being a record once nobody has focused it for DemoteDelay seconds.
+ *
+ * Records expire after the same rarity based lifetime as dropped pickups, and are cleaned up by UPickupSubsystem along with them.
+ */
+UCLASS(Config = Game)
+class SURVIVALGAME_API UWorldItemSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	UWorldItemSubsystem();
+
+	// [server] Put an item in the world at this transform. Returns false if it couldn't be added.
+	bool AddWorldItem(TSubclassOf<UItem> ItemClass, const int32 Quantity, const FTransform& Transform);
+
+	// [server] Take the item out of its chunk, destroying the chunk if that was its last item. Returns false if the record is already gone.
+	bool RemoveWorldItem(AWorldItemChunk* Chunk, const int32 RecordId, FWorldItemRecord* OutRemovedRecord = nullptr);
+
+	/** [server] Take the item out of its chunk and spawn a pickup of PickupClass for it in the same place.
+	 * @return the new pickup, or nullptr if the record is gone, e.g. someone else got to it first. */
+	APickup* PromoteToPickup(AWorldItemChunk* Chunk, const int32 RecordId, TSubclassOf<APickup> PickupClass);
+
+	// Chunks register themselves on both server and clients as they begin and end play.
+	void RegisterChunk(AWorldItemChunk* Chunk);
+	void UnregisterChunk(AWorldItemChunk* Chunk);
+
+	// Whether any chunk overlaps this sphere. World items aren't in the interaction subsystem, so spatial interaction checks use this to decide whether to trace for them.
+	bool HasChunkNear(const FVector& Location, const float Radius) const;
+
+	FORCEINLINE int32 GetNumChunks() const { return Chunks.Num(); }
+	FORCEINLINE int32 GetNumWorldItems() const { return NumWorldItems; }
+
+private:
+	FIntPoint GetChunkCoord(const FVector& Location) const;
+
+	// [server] Turn promoted pickups nobody has focused for DemoteDelay seconds back into records.
+	void DemotePickups();
+
+	struct FPromotedPickup
+	{
+		TWeakObjectPtr<APickup> Pickup;
+		float PromoteTime;
+	};
+
+	TArray<FPromotedPickup> PromotedPickups;
+
+	FTimerHandle DemoteTimerHandle;
+
+	UPROPERTY()
+	TMap<FIntPoint, AWorldItemChunk*> Chunks;
+
+	// [server] How many records are spread across all chunks.
+	int32 NumWorldItems;
+
+	// Size of a chunk in cm. Smaller chunks mean finer relevancy, but more actors once loot is spread out.
+	UPROPERTY(Config)
+	float ChunkSize;
+
+	// How long in seconds a promoted pickup can go without anyone focusing it before it becomes a record again. 0 keeps them as pickups.
+	UPROPERTY(Config)
+	float DemoteDelay;
+
+	// How often in seconds promoted pickups are checked for demotion.
+	UPROPERTY(Config)
+	float DemoteCheckInterval;
+};